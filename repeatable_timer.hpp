@@ -12,155 +12,2639 @@
 #include <atomic>
 #include <mutex>
 #include <iostream>
+#include <tuple>
+#include <variant>
+#include <vector>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <random>
+#include <numeric>
+#include <cmath>
+#include <thread>
+#include <stdexcept>
+#if defined(__linux__)
+#include <time.h>
+#endif
 
-/* A reusable, self‑rescheduling timer that carries a user‑supplied context.
+/* Counters for checking what the tick path costs, see ./test/alloc_test.cpp.
 
-  The callback signature is `void(Context&)`.
-  A `std::mutex` protects the context when the `io_context` runs on several threads.
-  See ./README.md for details
-  ./test/test.cpp has a test usage with cmake to build repeating_timer_test.
+  With REPEATING_TIMER_INSTRUMENT defined the timer counts ticks, and reference count
+  increments where the tick path takes them: the weak reference of a pending handler, and
+  locking it (or the plain counted anchor of a single thread timer). Each is undone by a
+  decrement when the handler or the locked pointer goes away.
+  Heap allocations are counted by replacement operator new/delete, defined by this header
+  when REPEATING_TIMER_COUNT_ALLOCATIONS is defined. Define that in exactly one translation
+  unit. Handler memory comes from asio, which recycles it per thread, so any handler
+  allocation that reaches the heap shows up here too.
 */
-template <typename Context>
-class RepeatingTimer
-    : public std::enable_shared_from_this<RepeatingTimer<Context>>
+struct TimerInstrumentation
+{
+    struct Counters
+    {
+        std::uint64_t allocations = 0;
+        std::uint64_t bytes = 0;
+        std::uint64_t refcount_increments = 0;
+        std::uint64_t ticks = 0;
+    };
+
+    inline static std::atomic<std::uint64_t> allocations{0};
+    inline static std::atomic<std::uint64_t> bytes{0};
+    inline static std::atomic<std::uint64_t> refcount_increments{0};
+    inline static std::atomic<std::uint64_t> ticks{0};
+
+    static Counters read()
+    {
+        return Counters{
+            allocations.load(std::memory_order_relaxed),
+            bytes.load(std::memory_order_relaxed),
+            refcount_increments.load(std::memory_order_relaxed),
+            ticks.load(std::memory_order_relaxed)};
+    }
+
+    static void count_allocation(std::size_t size) noexcept
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    static void count_refcount() noexcept
+    {
+#ifdef REPEATING_TIMER_INSTRUMENT
+        refcount_increments.fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+
+    static void count_tick() noexcept
+    {
+#ifdef REPEATING_TIMER_INSTRUMENT
+        ticks.fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+};
+
+/* Fixed-size slot pool for timers created with an in-place context.
+
+  Slots are carved out of contiguous chunks of `slots_per_chunk` slots, so timers and
+  their contexts created from the same arena sit next to each other in memory.
+  The slot size is taken from the first allocation, any other size falls back to the heap.
+  Every slot handed out keeps the chunks alive, so the arena may be destroyed before its
+  timers, and before the cancelled waits that still hold a weak reference into a slot.
+*/
+class TimerArena
 {
 public:
-    using Callback = std::function<void(Context&)>;
+    explicit TimerArena(std::size_t slots_per_chunk = 64)
+        : blocks_(std::make_shared<Blocks>(slots_per_chunk ? slots_per_chunk : 1))
+    {}
 
+    TimerArena(const TimerArena&) = delete;
+    TimerArena& operator=(const TimerArena&) = delete;
 
-    /// Create the timer, store the callback & context, then kick off the first tick.
-    /// cb_once if it exists
-    static std::shared_ptr<RepeatingTimer> create(
-        asio::io_context& io,
-        Callback cb,
-        std::chrono::milliseconds period,
-        std::shared_ptr<Context> ctx,
-        Callback cb_once = nullptr,
-        Callback cb_last = nullptr)
+    void* allocate(std::size_t bytes, std::size_t align) { return blocks_->allocate(bytes, align); }
+
+    void deallocate(void* p, std::size_t bytes, std::size_t align) noexcept
     {
-        auto timer = std::shared_ptr<RepeatingTimer>(
-            new RepeatingTimer(io, period, std::move(ctx)));
+        blocks_->deallocate(p, bytes, align);
+    }
 
-        timer->callback_ = std::move(cb);
-        timer->callfirst_ = std::move(cb_once);
-        timer->calllast_ = std::move(cb_last);
+    /// Number of slots currently holding a timer.
+    std::size_t in_use() const { return blocks_->in_use(); }
 
-        // Initialise the timer's expiry to now
-        timer->timer_.expires_after(std::chrono::steady_clock::duration(0));
-        timer->schedule_next();          // start the loop
-        return timer;
+private:
+    template <typename T> friend class ArenaAllocator;
+
+    // The chunks and their free list, shared by the arena and every allocator handed a slot
+    class Blocks
+    {
+    public:
+        explicit Blocks(std::size_t per_chunk) : per_chunk_(per_chunk) {}
+
+        void* allocate(std::size_t bytes, std::size_t align)
+        {
+            std::lock_guard<std::mutex> l(mtx_);
+            if (slot_size_ == 0 && align <= alignof(std::max_align_t)) {
+                // Round up so every slot in a chunk stays suitably aligned
+                slot_size_ = (bytes + alignof(std::max_align_t) - 1)
+                           / alignof(std::max_align_t) * alignof(std::max_align_t);
+            }
+            if (on_heap(bytes, align))
+                return ::operator new(bytes, std::align_val_t(align));
+
+            if (!free_)
+                grow();
+            FreeSlot* slot = free_;
+            free_ = slot->next;
+            ++in_use_;
+            return slot;
+        }
+
+        void deallocate(void* p, std::size_t bytes, std::size_t align) noexcept
+        {
+            std::lock_guard<std::mutex> l(mtx_);
+            if (on_heap(bytes, align)) {
+                ::operator delete(p, std::align_val_t(align));
+                return;
+            }
+            auto slot = static_cast<FreeSlot*>(p);
+            slot->next = free_;
+            free_ = slot;
+            --in_use_;
+        }
+
+        std::size_t in_use() const
+        {
+            std::lock_guard<std::mutex> l(mtx_);
+            return in_use_;
+        }
+
+    private:
+        struct FreeSlot { FreeSlot* next; };
+
+        // Allocate and deallocate must agree, a heap block on the free list would be too small
+        bool on_heap(std::size_t bytes, std::size_t align) const
+        {
+            return slot_size_ == 0 || bytes > slot_size_ || align > alignof(std::max_align_t);
+        }
+
+        void grow()
+        {
+            chunks_.emplace_back(new unsigned char[slot_size_ * per_chunk_]);
+            unsigned char* base = chunks_.back().get();
+            // Thread the free list front to back so consecutive creates get adjacent slots
+            for (std::size_t i = per_chunk_; i-- > 0;) {
+                auto slot = reinterpret_cast<FreeSlot*>(base + i * slot_size_);
+                slot->next = free_;
+                free_ = slot;
+            }
+        }
+
+        mutable std::mutex mtx_;
+        const std::size_t per_chunk_;
+        std::size_t slot_size_ = 0;
+        std::size_t in_use_ = 0;
+        FreeSlot* free_ = nullptr;
+        std::vector<std::unique_ptr<unsigned char[]>> chunks_;
+    };
+
+    std::shared_ptr<Blocks> blocks_;
+};
+
+/// Standard allocator handing out `TimerArena` slots, used with `std::allocate_shared`.
+/// Holds a reference to the arena's chunks, the copy a control block keeps lets the block
+/// be released after the arena is gone.
+template <typename T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(TimerArena& arena) noexcept : blocks_(arena.blocks_) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : blocks_(other.blocks_) {}
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(blocks_->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        blocks_->deallocate(p, n * sizeof(T), alignof(T));
     }
 
-    // Reschedule a running timer, can be once or persistent
-    void reschedule(std::chrono::milliseconds newPeriod, bool saveNew = false)
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept { return blocks_ == other.blocks_; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const noexcept { return blocks_ != other.blocks_; }
+
+private:
+    template <typename U> friend class ArenaAllocator;
+    std::shared_ptr<TimerArena::Blocks> blocks_;
+};
+
+// Storage for a context constructed in place, see RepeatingTimer::InlineSlot
+template <typename Context>
+struct InlineContext
+{
+    template <typename Tuple>
+    explicit InlineContext(Tuple&& args)
+        : value(std::apply([](auto&&... a) { return make(std::forward<decltype(a)>(a)...); },
+              std::forward<Tuple>(args)))
+    {}
+
+    // Like std::make_from_tuple, but aggregates (plain structs of counters) are brace initialised
+    template <typename... Args>
+    static Context make(Args&&... args)
     {
-        std::lock_guard<std::mutex> l(mtx_);
-        timer_.cancel();
+        if constexpr (std::is_constructible_v<Context, Args&&...>)
+            return Context(std::forward<Args>(args)...);
+        else
+            return Context{std::forward<Args>(args)...};
+    }
 
-        if (saveNew) {
-            period_ = newPeriod;
+    Context value;
+};
+
+/// Inline capacity of callbacks unless a timer asks for another, a few captured pointers.
+inline constexpr std::size_t default_callback_capacity = 4 * sizeof(void*);
+
+template <typename Signature, std::size_t Capacity = default_callback_capacity>
+class UniqueFunction;
+
+/* A move-only `std::function` replacement with small buffer optimisation.
+
+  Callables up to `Capacity` bytes that are nothrow movable are stored inline,
+  larger ones are moved to the heap. Move-only captures (unique_ptr, sockets) are fine.
+*/
+template <typename R, typename... Args, std::size_t Capacity>
+class UniqueFunction<R(Args...), Capacity>
+{
+    static_assert(Capacity >= sizeof(void*), "Capacity must at least hold a pointer");
+
+    template <typename F>
+    static constexpr bool fits_inline =
+        sizeof(F) <= Capacity &&
+        alignof(F) <= alignof(std::max_align_t) &&
+        std::is_nothrow_move_constructible_v<F>;
+
+    template <typename F> struct is_std_function : std::false_type {};
+    template <typename S> struct is_std_function<std::function<S>> : std::true_type {};
+
+public:
+    static constexpr std::size_t capacity = Capacity;
+
+    UniqueFunction() noexcept = default;
+    UniqueFunction(std::nullptr_t) noexcept {}
+
+    template <typename F, typename D = std::decay_t<F>,
+              typename = std::enable_if_t<
+                  !std::is_same_v<D, UniqueFunction> &&
+                  std::is_invocable_r_v<R, D&, Args...>>>
+    UniqueFunction(F&& f)
+    {
+        // Null function pointers and empty std::functions stay empty
+        if constexpr (std::is_pointer_v<D> || std::is_member_pointer_v<D> || is_std_function<D>::value) {
+            if (!f)
+                return;
+        }
+        if constexpr (fits_inline<D>) {
+            ::new (static_cast<void*>(buf_)) D(std::forward<F>(f));
+        }
+        else {
+            *reinterpret_cast<D**>(buf_) = new D(std::forward<F>(f));
         }
-        // Set the expiry to now, ensures the new period is applied
-        timer_.expires_after(std::chrono::steady_clock::duration(0));
-        schedule_next(newPeriod);
+        ops_ = &ops_for<D>;
     }
 
-    // Reschedule with same period, restart really
-    void reschedule() {
-        reschedule(period_);
+    UniqueFunction(UniqueFunction&& other) noexcept { take(other); }
+
+    UniqueFunction& operator=(UniqueFunction&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            take(other);
+        }
+        return *this;
     }
 
-    /// Stop the timer early (the destructor does the same).
-    void cancel()
+    UniqueFunction& operator=(std::nullptr_t) noexcept
     {
-        running_ = false;
-        timer_.cancel();
-        // Run the last call cb
-        if (calllast_) {
-            if(context_) std::lock_guard<std::mutex> lock(mtx_);
-            calllast_(*context_);
-            calllast_ = nullptr;
+        reset();
+        return *this;
+    }
+
+    UniqueFunction(const UniqueFunction&) = delete;
+    UniqueFunction& operator=(const UniqueFunction&) = delete;
+
+    ~UniqueFunction() { reset(); }
+
+    explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+    /// True when the target lives in the inline buffer, no heap allocation.
+    bool is_inline() const noexcept { return ops_ && ops_->local; }
+
+    R operator()(Args... args)
+    {
+        if (!ops_)
+            throw std::bad_function_call();
+        return ops_->invoke(buf_, std::forward<Args>(args)...);
+    }
+
+private:
+    struct Ops
+    {
+        R (*invoke)(void*, Args&&...);
+        void (*move)(void* dst, void* src) noexcept;
+        void (*destroy)(void*) noexcept;
+        bool local;
+    };
+
+    template <typename F>
+    static F* target(void* buf) noexcept
+    {
+        if constexpr (fits_inline<F>)
+            return std::launder(reinterpret_cast<F*>(buf));
+        else
+            return *reinterpret_cast<F**>(buf);
+    }
+
+    template <typename F>
+    static constexpr Ops ops_for = {
+        [](void* buf, Args&&... args) -> R {
+            return std::invoke(*target<F>(buf), std::forward<Args>(args)...);
+        },
+        [](void* dst, void* src) noexcept {
+            if constexpr (fits_inline<F>) {
+                ::new (dst) F(std::move(*target<F>(src)));
+                target<F>(src)->~F();
+            }
+            else {
+                *reinterpret_cast<F**>(dst) = target<F>(src);
+            }
+        },
+        [](void* buf) noexcept {
+            if constexpr (fits_inline<F>)
+                target<F>(buf)->~F();
+            else
+                delete target<F>(buf);
+        },
+        fits_inline<F>
+    };
+
+    void take(UniqueFunction& other) noexcept
+    {
+        if (other.ops_) {
+            other.ops_->move(buf_, other.buf_);
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+
+    void reset() noexcept
+    {
+        if (ops_) {
+            ops_->destroy(buf_);
+            ops_ = nullptr;
         }
     }
 
-    ~RepeatingTimer() { cancel(); }
+    alignas(std::max_align_t) unsigned char buf_[Capacity];
+    const Ops* ops_ = nullptr;
+};
+
+/// What a timer last reported about itself, as of its most recent tick.
+struct TimerStats
+{
+    std::chrono::nanoseconds period{0};
+    std::chrono::steady_clock::time_point next_deadline{};
+    std::uint64_t ticks = 0;
+    std::chrono::nanoseconds last_lateness{0};   // how long after its deadline the tick ran
+    std::chrono::nanoseconds last_cost{0};       // time spent in the callback
+};
+
+/* Sequence lock around a TimerStats.
+
+  The tick handler is the only writer and never waits, readers retry if a tick
+  published while they were copying, so a snapshot is always consistent.
+*/
+class TimerStatsCell
+{
+public:
+    void publish(const TimerStats& s) noexcept
+    {
+        const auto seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        period_.store(s.period.count(), std::memory_order_relaxed);
+        deadline_.store(s.next_deadline.time_since_epoch().count(), std::memory_order_relaxed);
+        ticks_.store(s.ticks, std::memory_order_relaxed);
+        lateness_.store(s.last_lateness.count(), std::memory_order_relaxed);
+        cost_.store(s.last_cost.count(), std::memory_order_relaxed);
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    TimerStats read() const noexcept
+    {
+        TimerStats s;
+        for (;;) {
+            const auto before = seq_.load(std::memory_order_acquire);
+            if (before & 1)
+                continue;                  // a publish is in progress
+            s.period = std::chrono::nanoseconds(period_.load(std::memory_order_relaxed));
+            s.next_deadline = std::chrono::steady_clock::time_point(
+                std::chrono::steady_clock::duration(deadline_.load(std::memory_order_relaxed)));
+            s.ticks = ticks_.load(std::memory_order_relaxed);
+            s.last_lateness = std::chrono::nanoseconds(lateness_.load(std::memory_order_relaxed));
+            s.last_cost = std::chrono::nanoseconds(cost_.load(std::memory_order_relaxed));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == before)
+                return s;
+        }
+    }
 
 private:
-    RepeatingTimer(asio::io_context& io,
-                   std::chrono::milliseconds period,
-                   std::shared_ptr<Context> ctx)
-        : timer_(io),
-          period_(period),
-          running_(true),
-          context_(std::move(ctx))
-    {}
+    std::atomic<std::uint64_t> seq_{0};
+    std::atomic<std::chrono::nanoseconds::rep> period_{0};
+    std::atomic<std::chrono::steady_clock::rep> deadline_{0};
+    std::atomic<std::uint64_t> ticks_{0};
+    std::atomic<std::chrono::nanoseconds::rep> lateness_{0};
+    std::atomic<std::chrono::nanoseconds::rep> cost_{0};
+};
 
-    // Deleted copy/move to avoid accidental misuse
-    RepeatingTimer(const RepeatingTimer&) = delete;
-    RepeatingTimer& operator=(const RepeatingTimer&) = delete;
-    RepeatingTimer(RepeatingTimer&&) = delete;
-    RepeatingTimer& operator=(RepeatingTimer&&) = delete;
+/// A lateness objective, `quantile` of the ticks run within `threshold` of their deadline.
+/// The quantile is taken over the last `window` ticks.
+struct LatencySlo
+{
+    std::chrono::nanoseconds threshold{0};
+    double quantile = 0.99;
+    std::uint32_t window = 1000;
+};
+
+/// Why a timer called its SLO hook.
+enum class SloEvent
+{
+    violation,   // this tick ran later than the threshold
+    breached,    // the rolling quantile went above the threshold
+    recovered    // and came back within it
+};
+
+/// What the SLO hook is told.
+struct SloReport
+{
+    SloEvent event;
+    std::uint64_t tick = 0;
+    std::chrono::nanoseconds lateness{0};   // of this tick
+    double late_fraction = 0.0;             // of the window later than the threshold
+};
+
+using SloHook = UniqueFunction<void(const SloReport&)>;
 
-    // Lock shared across all instances,
-    inline static std::mutex mtx_;
+/* Rolling count of the ticks that missed a LatencySlo.
 
-    void schedule_next() {
-        schedule_next(period_);
+  One bit per tick of the window in a ring, so recording a tick is a few integer
+  operations. The quantile is above the threshold exactly when more than
+  `(1 - quantile) * window` of the window were late. Until the window has filled the
+  missing ticks count as on time, a new timer doesn't breach on its first late tick.
+*/
+class SloWindow
+{
+public:
+    /// Start over with `slo`, a zero threshold turns the window off.
+    void reset(const LatencySlo& slo)
+    {
+        threshold_ = slo.threshold;
+        window_ = slo.window ? slo.window : 1;
+        // Rounded down, nudged so (1 - 0.9) * 10, which is 0.999... in floating point, allows one
+        allowed_ = static_cast<std::uint32_t>(std::floor((1.0 - slo.quantile) * window_ + 1e-9));
+        bits_.assign((window_ + 63) / 64, 0);
+        pos_ = 0;
+        late_ = 0;
+        breached_.store(false, std::memory_order_relaxed);
     }
 
-    void schedule_next(std::chrono::milliseconds this_period)
+    bool active() const { return threshold_.count() > 0; }
+    std::chrono::nanoseconds threshold() const { return threshold_; }
+    bool breached() const { return breached_.load(std::memory_order_relaxed); }
+    double late_fraction() const { return static_cast<double>(late_) / window_; }
+
+    /// Add one tick, true when that moved the quantile across the threshold.
+    bool record(bool late)
     {
-        // Don't do anything if we've been cancelled
-        if (!running_)
-            return;
+        auto& word = bits_[pos_ / 64];
+        const auto bit = std::uint64_t(1) << (pos_ % 64);
+        // The oldest tick leaves the window
+        if (word & bit)
+            late_--;
+        if (late) {
+            word |= bit;
+            late_++;
+        }
+        else
+            word &= ~bit;
+        if (++pos_ == window_)
+            pos_ = 0;
+        const bool over = late_ > allowed_;
+        if (over == breached())
+            return false;
+        breached_.store(over, std::memory_order_relaxed);
+        return true;
+    }
 
-        // Reset the timer and add a lambda to run when it expires
-        // There is once case with `callfirst_` if it is true don't add the period
-        // which ensures the timer will fire as soon as the async context schedules it
-        if(callfirst_) {
-            timer_.expires_at(timer_.expiry());
+private:
+    std::chrono::nanoseconds threshold_{0};
+    std::uint32_t window_ = 1;
+    std::uint32_t allowed_ = 0;
+    std::vector<std::uint64_t> bits_;
+    std::uint32_t pos_ = 0;
+    std::uint32_t late_ = 0;
+    std::atomic<bool> breached_{false};
+};
+
+/// Offloading and SLO state of a timer, only allocated once either is set.
+struct TimerTuning
+{
+    asio::any_io_executor offload_executor;
+    std::chrono::nanoseconds cost_ewma{0};
+    SloWindow slo;
+    SloHook slo_hook;
+};
+
+/// Measurement state of a timer, only kept when its policy has `stats`.
+template <bool Enabled>
+struct TimerMeasureState
+{
+    // A change made from another thread, queued until a tick holds the timer
+    using Setting = UniqueFunction<void(TimerMeasureState&)>;
+
+    TimerMeasureState() = default;
+    TimerMeasureState(const TimerMeasureState&) = delete;
+    TimerMeasureState& operator=(const TimerMeasureState&) = delete;
+    ~TimerMeasureState() { delete tuning.load(std::memory_order_relaxed); }
+
+    // Only called by the tick holding the timer, the first offload or SLO setting allocates it
+    TimerTuning& tune()
+    {
+        auto* t = tuning.load(std::memory_order_relaxed);
+        if (!t) {
+            t = new TimerTuning;
+            tuning.store(t, std::memory_order_release);
         }
-        else {
-            timer_.expires_at(timer_.expiry() + this_period);
+        return *t;
+    }
+
+    std::atomic<bool> enabled{false};
+    std::atomic<bool> offloaded{false};
+    std::atomic<bool> changed{false};
+    std::chrono::nanoseconds lateness{0};
+    std::chrono::nanoseconds cost{0};
+    std::chrono::nanoseconds offload_threshold{0};
+    TimerStatsCell stats;
+    std::atomic<TimerTuning*> tuning{nullptr};   // see tune(), read from other threads too
+    std::vector<Setting> pending;   // guarded by the timer's sched_mtx_
+};
+
+template <>
+struct TimerMeasureState<false> {};
+
+/// What a sliced callback reports back, see RepeatingTimer::create_sliced()
+enum class Slice { done, yield };
+
+/// The time a sliced callback may use before it should yield.
+class SliceBudget
+{
+public:
+    explicit SliceBudget(std::chrono::steady_clock::time_point deadline) : deadline_(deadline) {}
+
+    bool exhausted() const { return std::chrono::steady_clock::now() >= deadline_; }
+    std::chrono::steady_clock::time_point deadline() const { return deadline_; }
+
+private:
+    std::chrono::steady_clock::time_point deadline_;
+};
+
+#if defined(__linux__)
+/* Monotonic clock that keeps counting while the system is suspended (CLOCK_BOOTTIME).
+
+  With steady_clock a laptop that sleeps through a tick fires it one full period after
+  waking, with boot_clock the missed tick fires as soon as the system is back.
+*/
+struct boot_clock
+{
+    using duration = std::chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<boot_clock>;
+    static constexpr bool is_steady = true;
+
+    static time_point now() noexcept
+    {
+        timespec ts;
+        ::clock_gettime(CLOCK_BOOTTIME, &ts);
+        return time_point(std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec));
+    }
+};
+
+/// asio sleeps with relative timeouts on a clock that stops during suspend,
+/// so waits on the boot clock are cut into slices of at most `max_wait`.
+struct boot_clock_wait_traits
+{
+    static constexpr std::chrono::seconds max_wait{1};
+
+    static boot_clock::duration to_wait_duration(const boot_clock::duration& d)
+    {
+        return d > max_wait ? boot_clock::duration(max_wait) : d;
+    }
+
+    static boot_clock::duration to_wait_duration(const boot_clock::time_point& t)
+    {
+        return to_wait_duration(t - boot_clock::now());
+    }
+};
+#endif
+
+/// The asio wait traits a timer on `Clock` uses.
+template <typename Clock>
+struct clock_wait_traits { using type = asio::wait_traits<Clock>; };
+
+#if defined(__linux__)
+template <>
+struct clock_wait_traits<boot_clock> { using type = boot_clock_wait_traits; };
+#endif
+
+/* A timer period as an exact fraction of a second, `num / den` seconds.
+
+  Converts from any std::chrono duration. Rates that don't divide into whole clock
+  ticks, TimerPeriod::hertz(60) or TimerPeriod::per(3, std::chrono::milliseconds(10)),
+  keep their exact value and the timer places tick k at epoch + k * period, so they never drift.
+  `aligned()` puts the ticks on the boundaries of the clock instead, see BasicRepeatingTimer::align().
+*/
+struct TimerPeriod
+{
+    std::uint64_t num = 0;
+    std::uint64_t den = 1;
+    bool align = false;                    // tick on multiples of the period from the clock's epoch
+    std::chrono::nanoseconds align_offset{0};   // past each multiple, with align
+
+    constexpr TimerPeriod() = default;
+    constexpr TimerPeriod(std::uint64_t n, std::uint64_t d) : num(n), den(d ? d : 1) { reduce(); }
+
+    template <typename Rep, typename Period,
+              typename = std::enable_if_t<std::is_integral_v<Rep>>>
+    constexpr TimerPeriod(std::chrono::duration<Rep, Period> d)
+        : num(d.count() > 0 ? static_cast<std::uint64_t>(d.count()) * Period::num : 0),
+          den(Period::den)
+    {
+        reduce();
+    }
+
+    static constexpr TimerPeriod hertz(std::uint64_t hz) { return TimerPeriod(1, hz); }
+
+    /// The same period on the clock's boundaries, `offset` past each multiple of it.
+    /// Handed to a factory, the first tick is already on a boundary. The timer's policy
+    /// needs `align`, the factory throws std::invalid_argument otherwise.
+    constexpr TimerPeriod aligned(std::chrono::nanoseconds offset = std::chrono::nanoseconds(0)) const
+    {
+        TimerPeriod p = *this;
+        p.align = true;
+        p.align_offset = offset;
+        return p;
+    }
+
+    template <typename Rep, typename Period>
+    static constexpr TimerPeriod per(std::uint64_t ticks, std::chrono::duration<Rep, Period> d)
+    {
+        const TimerPeriod whole(d);
+        return TimerPeriod(whole.num, whole.den * (ticks ? ticks : 1));
+    }
+
+private:
+    constexpr void reduce()
+    {
+        const auto g = std::gcd(num, den);
+        if (g > 1) {
+            num /= g;
+            den /= g;
         }
-        // Use a weak pointer to pass a reference to the owning object into the lambda
-        // inside it, if you can't lock the weak pointer then the object is no longer referenced
-        std::weak_ptr<RepeatingTimer<Context>> wptr = this->shared_from_this();
-        timer_.async_wait([wptr](const asio::error_code& ec)
-        {
-            if (ec == asio::error::operation_aborted)
-                return;                    // cancelled
-            if (ec)
-            {
-                std::cerr << "RepeatingTimer error: " << ec.message() << '\n';
-                return;
-            }
-            // Make sure that the timer object is still referenced
-            if(auto self = wptr.lock()) {
-                // Guard the context against concurrent access, if a context is set
-                {
-                    if (self->context_) std::lock_guard<std::mutex> lock(self->mtx_);
-                    // If callfirst_ is callable do it now ... then destroy it
-                    // So .. call first and never again.
-                    if (self->callfirst_) {
-                        self->callfirst_(*self->context_);
-                        self->callfirst_ = nullptr;
-                    }
-                    else if (self->callback_)
-                        self->callback_(*self->context_);
-                }
-                // Reschedule only if still alive
-                if (self->running_)
-                    self->schedule_next();
-            }
-        });
     }
+};
 
-    asio::steady_timer timer_;
-    std::chrono::milliseconds period_;
-    std::atomic<bool> running_;
-    std::shared_ptr<Context> context_;
-    Callback callback_;
-    Callback callfirst_;
-    Callback calllast_;
+/// Stands in for a mutex where a policy needs no locking, compiles to nothing.
+struct NullTimerMutex
+{
+    void lock() noexcept {}
+    void unlock() noexcept {}
+    bool try_lock() noexcept { return true; }
 };
+
+/* The parts of std::atomic a timer uses over a plain value, compiles to plain loads and stores.
+
+  For timers whose policy confines them to a single thread.
+*/
+template <typename T>
+class UnsyncedCell
+{
+public:
+    constexpr UnsyncedCell(T v = T()) noexcept : value_(v) {}
+
+    T load(std::memory_order = std::memory_order_seq_cst) const noexcept { return value_; }
+    void store(T v, std::memory_order = std::memory_order_seq_cst) noexcept { value_ = v; }
+    T exchange(T v, std::memory_order = std::memory_order_seq_cst) noexcept
+    {
+        std::swap(v, value_);
+        return v;
+    }
+    T fetch_add(T v, std::memory_order = std::memory_order_seq_cst) noexcept
+    {
+        const T old = value_;
+        value_ += v;
+        return old;
+    }
+    T fetch_sub(T v, std::memory_order = std::memory_order_seq_cst) noexcept
+    {
+        const T old = value_;
+        value_ -= v;
+        return old;
+    }
+    T fetch_and(T v, std::memory_order = std::memory_order_seq_cst) noexcept
+    {
+        const T old = value_;
+        value_ &= v;
+        return old;
+    }
+    bool compare_exchange_strong(T& expected, T desired,
+                                 std::memory_order = std::memory_order_seq_cst) noexcept
+    {
+        if (value_ != expected) {
+            expected = value_;
+            return false;
+        }
+        value_ = desired;
+        return true;
+    }
+
+    operator T() const noexcept { return value_; }
+    UnsyncedCell& operator=(T v) noexcept
+    {
+        value_ = v;
+        return *this;
+    }
+
+private:
+    T value_;
+};
+
+/* Compile-time features of a BasicRepeatingTimer, derive from one to change a single switch.
+
+  Each timer holds two `mutex_type`s. One is held around every callback that has a context,
+  the other guards the schedule and is taken by reschedule(), align(), cancel() and the tick
+  handler, but never while a callback runs, so any callback may reschedule its own timer.
+  The default is recursive because cancel() runs the last call callback under the context
+  lock, with a plain std::mutex a callback that has a context must not cancel its own timer.
+  With `stats` false the measurement state (stats, offloading) and the clock reads around
+  the callback are compiled out, `stats_on_create` measures from the first tick.
+  `atomic_type` holds the flags the tick handler shares with other threads. With
+  `single_thread` the pending wait reaches the timer through a plain counted anchor
+  instead of locking a weak_ptr.
+  `sliced`, `async`, `budgets`, `jitter` and `align` make create_sliced(), create_async(),
+  set_budget(), set_jitter() and align() available. Switched off, their state takes no
+  space in the timer and their branches are compiled out of the tick path.
+  The clock and the callback storage are the Clock and CallbackCapacity parameters.
+*/
+struct DefaultTimerPolicy
+{
+    using mutex_type = std::recursive_mutex;
+    template <typename T>
+    using atomic_type = std::atomic<T>;
+    static constexpr bool single_thread = false;
+    static constexpr bool stats = true;
+    static constexpr bool stats_on_create = false;
+    static constexpr bool sliced = true;
+    static constexpr bool async = true;
+    static constexpr bool budgets = true;
+    static constexpr bool jitter = true;
+    static constexpr bool align = true;
+};
+
+/// Nothing but the callback and the re-arm on the tick path.
+struct LeanTimerPolicy : DefaultTimerPolicy
+{
+    static constexpr bool stats = false;
+    static constexpr bool sliced = false;
+    static constexpr bool async = false;
+    static constexpr bool budgets = false;
+    static constexpr bool jitter = false;
+    static constexpr bool align = false;
+};
+
+/// Stats measured from the first tick, ready for a TimerRegistry or a profiler.
+struct InstrumentedTimerPolicy : DefaultTimerPolicy
+{
+    static constexpr bool stats_on_create = true;
+};
+
+/* No locks and no atomics on the tick path, for an io_context run by one thread
+  (ideally constructed with ASIO_CONCURRENCY_HINT_UNSAFE).
+
+  Every call on the timer, including its destruction, must happen on that thread,
+  and a callback must not drop the last reference to its own timer, cancel() it instead.
+*/
+struct SingleThreadTimerPolicy : LeanTimerPolicy
+{
+    using mutex_type = NullTimerMutex;
+    template <typename T>
+    using atomic_type = UnsyncedCell<T>;
+    static constexpr bool single_thread = true;
+};
+
+/// The callback signature of a timer on `Context`, without the context reference when it is void.
+template <typename Context, typename R, typename... Args>
+struct timer_signature { using type = R(Context&, Args...); };
+
+template <typename R, typename... Args>
+struct timer_signature<void, R, Args...> { using type = R(Args...); };
+
+template <typename Context, typename R, typename... Args>
+using timer_signature_t = typename timer_signature<Context, R, Args...>::type;
+
+/// What create() does so a timer's first ticks are as quick as the later ones.
+enum class WarmUp
+{
+    none,
+    prefault,    // touch the timer and its context, and the io thread's clocks and per thread state
+    dry_run      // prefault, then call the callback once on the io thread ahead of the schedule,
+                 // unless a call first callback has to run before it
+};
+
+// Reads every cache line of an object, so its pages are mapped and the lines are hot
+inline void prefault_memory(const void* p, std::size_t bytes)
+{
+    auto bytes_p = static_cast<const volatile unsigned char*>(p);
+    for (std::size_t i = 0; i < bytes; i += 64)
+        (void)bytes_p[i];
+}
+
+/* Shares each io thread between due timers and the other completions on its executor.
+
+  Timers given the same TickBudget (see RepeatingTimer::set_budget()) add up the time their
+  callbacks take on each io thread. Once a thread has spent `budget` on ticks, the next ticks
+  due on it are posted to the back of the executor's queue instead of running, so completions
+  already waiting (socket reads, ...) go first. The thread starts a fresh budget when one of
+  the deferred ticks comes round. Must outlive the timers using it.
+*/
+class TickBudget
+{
+public:
+    explicit TickBudget(std::chrono::microseconds budget) : budget_(budget), id_(next_id()) {}
+
+    TickBudget(const TickBudget&) = delete;
+    TickBudget& operator=(const TickBudget&) = delete;
+
+    std::chrono::microseconds budget() const { return budget_; }
+
+    /// Ticks pushed back behind other work so far, over all threads.
+    std::uint64_t deferred() const { return deferred_.load(std::memory_order_relaxed); }
+
+    /// True if a tick may run on this thread now, false if it should be deferred.
+    bool admit() { return used() < budget_; }
+
+    /// Add the cost of a tick that ran on this thread.
+    void charge(std::chrono::nanoseconds cost) { used() += cost; }
+
+    /// A tick is being deferred.
+    void defer() { deferred_.fetch_add(1, std::memory_order_relaxed); }
+
+    /// A deferred tick came round, the completions queued ahead of it have run.
+    void resume()
+    {
+        // Nothing spent is the same as no entry, keeps the list down to budgets in use
+        auto& all = spent();
+        for (auto& s : all) {
+            if (s.id == id_) {
+                s = all.back();
+                all.pop_back();
+                return;
+            }
+        }
+    }
+
+private:
+    struct Spent
+    {
+        std::uint64_t id;
+        std::chrono::nanoseconds used;
+    };
+
+    // Spend of every budget this thread is using, by id so a budget reusing the address
+    // of a destroyed one starts from nothing. Rarely more than one or two entries.
+    static std::vector<Spent>& spent()
+    {
+        thread_local std::vector<Spent> all;
+        return all;
+    }
+
+    static std::uint64_t next_id()
+    {
+        static std::atomic<std::uint64_t> next{0};
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Time spent on ticks by this thread in its current round
+    std::chrono::nanoseconds& used()
+    {
+        auto& all = spent();
+        for (auto& s : all) {
+            if (s.id == id_)
+                return s.used;
+        }
+        all.push_back(Spent{id_, std::chrono::nanoseconds(0)});
+        return all.back().used;
+    }
+
+    const std::chrono::microseconds budget_;
+    const std::uint64_t id_;
+    std::atomic<std::uint64_t> deferred_{0};
+};
+
+/* Where a timer's ticks run, accepted wherever a timer is created.
+
+  Either an execution context (io_context, thread_pool), which runs the ticks on its
+  executor, or any asio executor such as a strand, so callbacks land on the right strand
+  without an extra post.
+*/
+struct TimerExecutor
+{
+    template <typename Executor, typename = std::enable_if_t<
+        std::is_convertible_v<const Executor&, asio::any_io_executor>>>
+    TimerExecutor(const Executor& ex) : executor(ex) {}
+
+    template <typename ExecutionContext, typename = std::enable_if_t<
+        std::is_base_of_v<asio::execution_context, ExecutionContext>>, typename = void>
+    TimerExecutor(ExecutionContext& ctx) : executor(ctx.get_executor()) {}
+
+    asio::any_io_executor executor;
+};
+
+template <typename Timer>
+class TimerPool;
+
+/* Timer state of the features a policy can switch off, see DefaultTimerPolicy.
+
+  A BasicRepeatingTimer derives from TimerFeatureState, a feature that is off is an
+  empty base in its place so it adds nothing to the size of the timer.
+*/
+template <typename Clock, typename Policy>
+struct TimerAlignState
+{
+    typename Policy::template atomic_type<bool> aligned_{false};
+    typename Clock::duration align_offset_{0};
+    typename Clock::time_point boundary_{};   // unjittered deadline of the last aligned tick
+};
+
+template <typename Clock, typename Policy>
+struct TimerJitterState
+{
+    typename Policy::template atomic_type<typename Clock::rep> jitter_{0};
+};
+
+template <typename Policy>
+struct TimerBudgetState
+{
+    typename Policy::template atomic_type<TickBudget*> budget_{nullptr};
+};
+
+struct TimerSliceState
+{
+    std::chrono::microseconds slice_budget_{0};
+};
+
+template <typename Policy>
+struct TimerAsyncState
+{
+    std::size_t max_in_flight_ = 0;
+    typename Policy::template atomic_type<std::size_t> in_flight_{0};
+    typename Policy::template atomic_type<unsigned> held_{0};
+};
+
+// Stands in for a feature that is off, one type per feature so they can all be empty bases
+template <int Feature>
+struct TimerFeatureOff {};
+
+template <typename Clock, typename Policy>
+struct TimerFeatureState
+    : std::conditional_t<Policy::align, TimerAlignState<Clock, Policy>, TimerFeatureOff<0>>,
+      std::conditional_t<Policy::jitter, TimerJitterState<Clock, Policy>, TimerFeatureOff<1>>,
+      std::conditional_t<Policy::budgets, TimerBudgetState<Policy>, TimerFeatureOff<2>>,
+      std::conditional_t<Policy::sliced, TimerSliceState, TimerFeatureOff<3>>,
+      std::conditional_t<Policy::async, TimerAsyncState<Policy>, TimerFeatureOff<4>>
+{};
+
+/* A reusable, self‑rescheduling timer that carries a user‑supplied context.
+
+  `Clock` is any std::chrono style clock asio can wait on, see RepeatingTimer,
+  SystemRepeatingTimer and BootRepeatingTimer below for the common ones.
+
+  The callback signature is `void(Context&)`, callbacks may be move-only and are stored
+  inline when they fit in `CallbackCapacity` bytes. With `Context = void` the timer is
+  contextless, callbacks are `void()` and there is no context to store, dereference or lock.
+  `Policy` picks the lock, whether the timer can measure itself and which of the optional
+  features it carries, see DefaultTimerPolicy.
+  By default a mutex protects the context when the `io_context` runs on several threads.
+  See ./README.md for details
+  ./test/test.cpp has a test usage with cmake to build repeating_timer_test.
+*/
+template <typename Context,
+          typename Clock = std::chrono::steady_clock,
+          std::size_t CallbackCapacity = default_callback_capacity,
+          typename Policy = DefaultTimerPolicy>
+class BasicRepeatingTimer
+    : public std::enable_shared_from_this<BasicRepeatingTimer<Context, Clock, CallbackCapacity, Policy>>,
+      private TimerFeatureState<Clock, Policy>
+{
+public:
+    using clock_type = Clock;
+    using policy_type = Policy;
+    using time_point = typename Clock::time_point;
+    using Callback = UniqueFunction<timer_signature_t<Context, void>, CallbackCapacity>;
+
+    /// What the tick handler knows about the tick it is running.
+    struct TickInfo
+    {
+        time_point scheduled{};            // the deadline, including any jitter
+        time_point actual{};               // when the handler ran
+        std::uint64_t index = 0;           // ticks before this one
+        std::uint64_t missed = 0;          // whole periods between scheduled and actual
+    };
+    using TickCallback = UniqueFunction<timer_signature_t<Context, void, const TickInfo&>, CallbackCapacity>;
+    using SlicedCallback = UniqueFunction<timer_signature_t<Context, Slice, const SliceBudget&>, CallbackCapacity>;
+
+    /// Handed to an async callback, call it once the work the tick started has finished.
+    /// It may be called from any thread. Dropping it uncalled counts as completion too,
+    /// so a lost handle can't stall the timer.
+    class Done
+    {
+    public:
+        Done(Done&& other) noexcept : timer_(std::move(other.timer_)) {}
+        Done& operator=(Done&& other) noexcept
+        {
+            if (this != &other) {
+                complete();
+                timer_ = std::move(other.timer_);
+            }
+            return *this;
+        }
+        Done(const Done&) = delete;
+        Done& operator=(const Done&) = delete;
+        ~Done() { complete(); }
+
+        void operator()() { complete(); }
+
+    private:
+        friend class BasicRepeatingTimer;
+        explicit Done(std::weak_ptr<BasicRepeatingTimer> timer) : timer_(std::move(timer)) {}
+
+        void complete()
+        {
+            auto self = lock_self(timer_);
+            timer_.reset();
+            if (!self)
+                return;
+            // Back onto the timer's executor, never re-entering the callback that started it
+            asio::post(self->timer_.get_executor(), [wptr = self->weak_self()]()
+            {
+                if (auto self = lock_self(wptr))
+                    self->async_done();
+            });
+        }
+
+        std::weak_ptr<BasicRepeatingTimer> timer_;
+    };
+    using AsyncCallback = UniqueFunction<timer_signature_t<Context, void, Done>, CallbackCapacity>;
+
+    /// `max_in_flight` of create_async() that re-arms only once the last call completed.
+    static constexpr std::size_t fixed_delay = 0;
+
+
+    /// Create the timer, store the callback & context, then kick off the first tick.
+    /// cb_once if it exists
+    static std::shared_ptr<BasicRepeatingTimer> create(
+        TimerExecutor io,
+        Callback cb,
+        TimerPeriod period,
+        std::shared_ptr<Context> ctx,
+        Callback cb_once = nullptr,
+        Callback cb_last = nullptr,
+        WarmUp warm_up = WarmUp::none)
+    {
+        auto timer = std::shared_ptr<BasicRepeatingTimer>(
+            new BasicRepeatingTimer(std::move(io), period, std::move(ctx)));
+
+        return start(std::move(timer), make_handler(std::move(cb)), std::move(cb_once), std::move(cb_last), warm_up);
+    }
+
+    /// Create the timer with a callback that also gets the TickInfo, so it can compensate
+    /// for lateness without reading the clock itself. Costs one clock read per tick.
+    static std::shared_ptr<BasicRepeatingTimer> create(
+        TimerExecutor io,
+        TickCallback cb,
+        TimerPeriod period,
+        std::shared_ptr<Context> ctx,
+        Callback cb_once = nullptr,
+        Callback cb_last = nullptr,
+        WarmUp warm_up = WarmUp::none)
+    {
+        auto timer = std::shared_ptr<BasicRepeatingTimer>(
+            new BasicRepeatingTimer(std::move(io), period, std::move(ctx)));
+
+        return start(std::move(timer), make_handler(std::move(cb)), std::move(cb_once), std::move(cb_last), warm_up);
+    }
+
+    /// Create a contextless timer, `RepeatingTimer<void>`, there is no context to pass.
+    template <typename C = Context, typename = std::enable_if_t<std::is_void_v<C>>>
+    static std::shared_ptr<BasicRepeatingTimer> create(
+        TimerExecutor io,
+        Callback cb,
+        TimerPeriod period,
+        Callback cb_once = nullptr,
+        Callback cb_last = nullptr,
+        WarmUp warm_up = WarmUp::none)
+    {
+        return create(std::move(io), std::move(cb), period, nullptr, std::move(cb_once), std::move(cb_last), warm_up);
+    }
+
+    /// Create a contextless timer with a callback that gets the TickInfo.
+    template <typename C = Context, typename = std::enable_if_t<std::is_void_v<C>>>
+    static std::shared_ptr<BasicRepeatingTimer> create(
+        TimerExecutor io,
+        TickCallback cb,
+        TimerPeriod period,
+        Callback cb_once = nullptr,
+        Callback cb_last = nullptr,
+        WarmUp warm_up = WarmUp::none)
+    {
+        return create(std::move(io), std::move(cb), period, nullptr, std::move(cb_once), std::move(cb_last), warm_up);
+    }
+
+    /// Create a timer whose callback works in slices of at most `budget`.
+    /// The callback returns Slice::yield when it checks the budget and finds it exhausted,
+    /// it is called again from a fresh handler on the executor so other work can run between
+    /// slices. The next tick is armed once it returns Slice::done.
+    static std::shared_ptr<BasicRepeatingTimer> create_sliced(
+        TimerExecutor io,
+        SlicedCallback cb,
+        TimerPeriod period,
+        std::shared_ptr<Context> ctx,
+        std::chrono::microseconds budget,
+        Callback cb_once = nullptr,
+        Callback cb_last = nullptr,
+        WarmUp warm_up = WarmUp::none)
+    {
+        static_assert(Policy::sliced, "the policy compiled sliced callbacks out");
+        auto timer = std::shared_ptr<BasicRepeatingTimer>(
+            new BasicRepeatingTimer(std::move(io), period, std::move(ctx)));
+        timer->slice_budget_ = budget;
+
+        return start(std::move(timer), make_handler(std::move(cb)), std::move(cb_once), std::move(cb_last), warm_up);
+    }
+
+    /// Create a timer whose callback starts asynchronous work and reports back through Done.
+    /// With `fixed_delay` the next tick is armed one period after the call completes, so calls
+    /// never overlap. With a limit the timer keeps its rate with up to `max_in_flight` calls
+    /// outstanding, a tick that finds the limit reached is held and runs as soon as one completes.
+    static std::shared_ptr<BasicRepeatingTimer> create_async(
+        TimerExecutor io,
+        AsyncCallback cb,
+        TimerPeriod period,
+        std::shared_ptr<Context> ctx,
+        std::size_t max_in_flight = fixed_delay,
+        Callback cb_once = nullptr,
+        Callback cb_last = nullptr,
+        WarmUp warm_up = WarmUp::none)
+    {
+        static_assert(Policy::async, "the policy compiled async callbacks out");
+        auto timer = std::shared_ptr<BasicRepeatingTimer>(
+            new BasicRepeatingTimer(std::move(io), period, std::move(ctx)));
+        timer->max_in_flight_ = max_in_flight;
+
+        return start(std::move(timer), make_handler(std::move(cb)), std::move(cb_once), std::move(cb_last), warm_up);
+    }
+
+    /// Async calls started but not yet completed, zero when the policy compiled them out.
+    std::size_t in_flight() const
+    {
+        if constexpr (Policy::async)
+            return this->in_flight_.load(std::memory_order_relaxed);
+        else
+            return 0;
+    }
+
+    /// Create the timer with its context constructed inside it from `ctx_args`
+    /// (see std::make_from_tuple). Timer and context share one allocation and the same
+    /// cache lines, the context is destroyed with the timer.
+    template <typename... Args>
+    static std::shared_ptr<BasicRepeatingTimer> create(
+        TimerExecutor io,
+        Callback cb,
+        TimerPeriod period,
+        std::in_place_t,
+        std::tuple<Args...> ctx_args = {},
+        Callback cb_once = nullptr,
+        Callback cb_last = nullptr,
+        WarmUp warm_up = WarmUp::none)
+    {
+        std::shared_ptr<BasicRepeatingTimer> timer = std::make_shared<InlineSlot>(
+            std::move(io), period, std::move(ctx_args));
+
+        return start(std::move(timer), make_handler(std::move(cb)), std::move(cb_once), std::move(cb_last), warm_up);
+    }
+
+    /// Create the timer from `pool`, reusing a released timer (and its asio timer) if one
+    /// is idle. Releasing the last reference cancels it and hands it back to the pool.
+    static std::shared_ptr<BasicRepeatingTimer> create(
+        TimerPool<BasicRepeatingTimer>& pool,
+        Callback cb,
+        TimerPeriod period,
+        std::shared_ptr<Context> ctx,
+        Callback cb_once = nullptr,
+        Callback cb_last = nullptr,
+        WarmUp warm_up = WarmUp::none)
+    {
+        check_period(period);
+        BasicRepeatingTimer* raw = pool.pop();
+        raw->set_period(period);
+        raw->context_ = take_context(std::move(ctx));
+        // The reference counts go in a pool slot too
+        std::shared_ptr<BasicRepeatingTimer> timer(raw,
+            [&pool](BasicRepeatingTimer* t) {
+                t->recycle();
+                pool.push(t);
+            },
+            ArenaAllocator<BasicRepeatingTimer>(pool.blocks_));
+
+        return start(std::move(timer), make_handler(std::move(cb)), std::move(cb_once), std::move(cb_last), warm_up);
+    }
+
+    /// Create a contextless timer from `pool`.
+    template <typename C = Context, typename = std::enable_if_t<std::is_void_v<C>>>
+    static std::shared_ptr<BasicRepeatingTimer> create(
+        TimerPool<BasicRepeatingTimer>& pool,
+        Callback cb,
+        TimerPeriod period,
+        Callback cb_once = nullptr,
+        Callback cb_last = nullptr,
+        WarmUp warm_up = WarmUp::none)
+    {
+        return create(pool, std::move(cb), period, nullptr, std::move(cb_once), std::move(cb_last), warm_up);
+    }
+
+    /// Create the timer in a slot of `arena`, the context is constructed in the same slot
+    /// from `ctx_args` (see std::make_from_tuple) and is destroyed with the timer.
+    template <typename... Args>
+    static std::shared_ptr<BasicRepeatingTimer> create(
+        TimerArena& arena,
+        TimerExecutor io,
+        Callback cb,
+        TimerPeriod period,
+        std::tuple<Args...> ctx_args = {},
+        Callback cb_once = nullptr,
+        Callback cb_last = nullptr,
+        WarmUp warm_up = WarmUp::none)
+    {
+        std::shared_ptr<BasicRepeatingTimer> timer = std::allocate_shared<InlineSlot>(
+            ArenaAllocator<InlineSlot>(arena), std::move(io), period, std::move(ctx_args));
+
+        return start(std::move(timer), make_handler(std::move(cb)), std::move(cb_once), std::move(cb_last), warm_up);
+    }
+
+    // Reschedule a running timer, can be once or persistent
+    void reschedule(TimerPeriod newPeriod, bool saveNew = false)
+    {
+        std::lock_guard<mutex_type> l(sched_mtx_);
+        if (saveNew) {
+            set_period(newPeriod);
+        }
+        // Anchor at now, ensures the new period is applied
+        rearm(Clock::now(), to_clock(newPeriod));
+    }
+
+    // Reschedule with same period, restart really
+    void reschedule() {
+        std::lock_guard<mutex_type> l(sched_mtx_);
+        rearm(Clock::now(), period());
+    }
+
+    /// Reschedule a set of timers (any range of shared_ptrs to timers of this type) in one pass.
+    /// The clock is read once and every timer is anchored to that instant, so they all switch
+    /// to `newPeriod` on the same tick boundary. A tick already running on another io thread
+    /// finishes first, the new schedule is armed as it does.
+    template <typename Timers>
+    static void reschedule_all(Timers& timers, TimerPeriod newPeriod, bool saveNew = false)
+    {
+        const auto anchor = Clock::now();
+        for (auto& timer : timers) {
+            if (!timer)
+                continue;
+            std::lock_guard<mutex_type> l(timer->sched_mtx_);
+            if (saveNew) {
+                timer->set_period(newPeriod);
+            }
+            timer->rearm(anchor, to_clock(newPeriod));
+        }
+    }
+
+    /// Move the next tick of a set of timers to `deadline`, they keep their own
+    /// periods afterwards and stay in phase with each other.
+    template <typename Timers>
+    static void reschedule_all(Timers& timers, time_point deadline)
+    {
+        for (auto& timer : timers) {
+            if (!timer)
+                continue;
+            std::lock_guard<mutex_type> l(timer->sched_mtx_);
+            timer->rearm(deadline, typename Clock::duration(0));
+        }
+    }
+
+    /// Tick on multiples of the period counted from the clock's epoch, plus `offset`.
+    /// A one minute SystemRepeatingTimer then fires at the start of every wall clock minute.
+    /// Each deadline is worked out from the current time, so after a clock adjustment the
+    /// schedule snaps back onto the boundaries at the next tick. A tick of the old schedule
+    /// may already be running, create the timer with `period.aligned(offset)` to have the
+    /// first tick on a boundary too.
+    void align(std::chrono::milliseconds offset = std::chrono::milliseconds(0))
+    {
+        static_assert(Policy::align, "the policy compiled alignment out");
+        std::lock_guard<mutex_type> l(sched_mtx_);
+        this->align_offset_ = std::chrono::duration_cast<typename Clock::duration>(offset);
+        this->boundary_ = time_point();
+        this->aligned_.store(true, std::memory_order_release);
+        restart_ = false;
+        rearm(time_point(), typename Clock::duration(0));
+    }
+
+    /// Move every tick by a random amount of up to `max_jitter` either way, so timers
+    /// started together in many processes drift out of phase. The jitter is drawn fresh
+    /// for each tick around the undisturbed schedule, so the average period is unchanged.
+    void set_jitter(typename Clock::duration max_jitter)
+    {
+        static_assert(Policy::jitter, "the policy compiled jitter out");
+        this->jitter_.store(max_jitter.count(), std::memory_order_relaxed);
+    }
+
+    /// Stop the timer early (the destructor does the same).
+    void cancel()
+    {
+        {
+            std::lock_guard<mutex_type> l(sched_mtx_);
+            running_ = false;
+            timer_.cancel();
+        }
+        // Run the last call cb
+        if (calllast_) {
+            std::unique_lock<mutex_type> lock(context_mtx_, std::defer_lock);
+            if (has_context())
+                lock.lock();
+            call(calllast_);
+            calllast_ = nullptr;
+        }
+    }
+
+    /// The executor the ticks run on.
+    auto get_executor() { return timer_.get_executor(); }
+
+    /// Measure lateness and callback cost on every tick, costs two clock reads per tick.
+    /// Does nothing when the policy compiled stats out.
+    void enable_stats(bool enable = true)
+    {
+        if constexpr (Policy::stats)
+            measure_.enabled = enable;
+    }
+
+    /// Figures published by the most recent tick, zero until stats are enabled.
+    TimerStats stats() const
+    {
+        if constexpr (Policy::stats)
+            return measure_.stats.read();
+        else
+            return TimerStats{};
+    }
+
+    /// Run the callback on `executor` (a thread_pool for example) while its average cost
+    /// is above `threshold`, and inline again once it drops below half of that.
+    /// Costs two clock reads per tick, a zero threshold turns it off.
+    /// May be called from any thread, takes effect from the next tick to start.
+    void offload_when_slow(asio::any_io_executor executor, std::chrono::microseconds threshold)
+    {
+        static_assert(Policy::stats, "offloading measures callback cost, the policy needs stats");
+        change_settings([executor = std::move(executor), threshold](TimerMeasureState<true>& m) mutable
+        {
+            m.tune().offload_executor = std::move(executor);
+            m.offload_threshold = threshold;
+            m.offloaded = m.offloaded && threshold.count();
+        });
+    }
+
+    /// Hold the ticks to a lateness objective, `hook` runs on the io thread for every tick
+    /// later than `slo.threshold` and when the rolling quantile crosses it, in either direction.
+    /// Takes the lateness from the one clock read a tick already makes for stats or TickInfo.
+    /// The hook is called without the context lock, ahead of the callback, so shedding load
+    /// from it applies to this tick. A zero threshold turns it off.
+    /// May be called from any thread, takes effect from the next tick to start.
+    void set_slo(const LatencySlo& slo, SloHook hook)
+    {
+        static_assert(Policy::stats, "an SLO measures lateness, the policy needs stats");
+        change_settings([slo, hook = std::move(hook)](TimerMeasureState<true>& m) mutable
+        {
+            auto& tuning = m.tune();
+            tuning.slo.reset(slo);
+            tuning.slo_hook = std::move(hook);
+        });
+    }
+
+    /// Count this timer's ticks against `budget` (shared with other timers), ticks due once
+    /// the io thread has used it up wait behind the other pending completions.
+    /// nullptr turns it off. Each tick reads the budget once, a tick already running
+    /// finishes on the one it started with.
+    void set_budget(TickBudget* budget)
+    {
+        static_assert(Policy::budgets, "the policy compiled tick budgets out");
+        this->budget_.store(budget, std::memory_order_release);
+    }
+
+    /// Touch the memory the tick path uses ahead of time, see WarmUp. create() can do this
+    /// before the first tick, on a running timer it helps ahead of an expected burst.
+    /// The io thread part is posted to the timer's executor.
+    void warm(WarmUp mode = WarmUp::prefault)
+    {
+        if (mode == WarmUp::none)
+            return;
+        prefault_memory(this, sizeof(*this));
+        if constexpr (!std::is_void_v<Context>) {
+            if (context_)
+                prefault_memory(context_.get(), sizeof(Context));
+        }
+        std::weak_ptr<BasicRepeatingTimer> wptr = this->shared_from_this();
+        asio::post(timer_.get_executor(), [wptr, mode]()
+        {
+            auto self = wptr.lock();
+            if (!self || !self->running_)
+                return;
+            // First use on this thread of the clocks and the per thread state of a tick
+            (void)Clock::now();
+            (void)std::chrono::steady_clock::now();
+            if constexpr (Policy::jitter)
+                (void)jitter_random();
+            if constexpr (Policy::budgets) {
+                if (auto* budget = self->budget_.load(std::memory_order_acquire))
+                    (void)budget->admit();
+            }
+            prefault_memory(self.get(), sizeof(*self));
+            if (mode != WarmUp::dry_run)
+                return;
+            // Holds the timer like a tick, so the dry run never overlaps one
+            const auto gen = self->generation_.load() & ~busy;
+            if (!self->claim(gen))
+                return;
+            // The call first callback runs before any other, a dry run would break that
+            if (!self->call_first_ && self->has_callback()) {
+                std::unique_lock<mutex_type> lock(self->context_mtx_, std::defer_lock);
+                if (self->has_context())
+                    lock.lock();
+                TickInfo info;
+                info.scheduled = info.actual = Clock::now();
+                self->invoke_callback(info);
+            }
+            std::lock_guard<mutex_type> l(self->sched_mtx_);
+            self->release(gen, false);
+        });
+    }
+
+    /// True while the callback is running on the offload executor.
+    bool offloaded() const
+    {
+        if constexpr (Policy::stats)
+            return measure_.offloaded;
+        else
+            return false;
+    }
+
+    /// True while the rolling lateness quantile is above the SLO threshold.
+    bool slo_breached() const
+    {
+        if constexpr (Policy::stats) {
+            const auto* tuning = measure_.tuning.load(std::memory_order_acquire);
+            return tuning && tuning->slo.breached();
+        }
+        else
+            return false;
+    }
+
+    ~BasicRepeatingTimer()
+    {
+        cancel();
+        anchor_.clear();
+    }
+
+private:
+    using timer_type = asio::basic_waitable_timer<Clock, typename clock_wait_traits<Clock>::type>;
+
+    // The one callback a timer ticks with, whatever its kind, in a single slot
+    using Handler = std::variant<std::monostate, Callback, TickCallback, SlicedCallback, AsyncCallback>;
+    enum class HandlerKind : std::size_t { none, plain, with_info, sliced, async };
+
+    template <typename F>
+    static Handler make_handler(F f)
+    {
+        if (!f)
+            return Handler();
+        return Handler(std::in_place_type<F>, std::move(f));
+    }
+
+    // Shared by a single thread timer and its pending waits, cleared when the timer dies
+    struct Anchor
+    {
+        BasicRepeatingTimer* timer;
+        std::size_t refs;
+    };
+
+    // Plain counted reference to an Anchor, never touched by more than one thread
+    class AnchorRef
+    {
+    public:
+        AnchorRef() = default;
+        explicit AnchorRef(BasicRepeatingTimer* timer)
+            : anchor_(timer ? new Anchor{timer, 1} : nullptr) {}
+        AnchorRef(const AnchorRef& other) noexcept : anchor_(other.anchor_)
+        {
+            if (anchor_) {
+                anchor_->refs++;
+                TimerInstrumentation::count_refcount();
+            }
+        }
+        AnchorRef(AnchorRef&& other) noexcept : anchor_(other.anchor_) { other.anchor_ = nullptr; }
+        AnchorRef& operator=(const AnchorRef&) = delete;
+        AnchorRef& operator=(AnchorRef&&) = delete;
+        ~AnchorRef()
+        {
+            if (anchor_ && --anchor_->refs == 0)
+                delete anchor_;
+        }
+
+        explicit operator bool() const noexcept { return anchor_ != nullptr; }
+        BasicRepeatingTimer* get() const noexcept { return anchor_ ? anchor_->timer : nullptr; }
+        void clear() noexcept
+        {
+            if (anchor_)
+                anchor_->timer = nullptr;
+        }
+
+    private:
+        Anchor* anchor_ = nullptr;
+    };
+
+    BasicRepeatingTimer(TimerExecutor io,
+                        TimerPeriod period,
+                        std::shared_ptr<Context> ctx)
+        : BasicRepeatingTimer(timer_type(std::move(io.executor)), period, std::move(ctx))
+    {}
+
+    // A recycled timer passes in the anchor of its previous life, and the generation to carry on
+    // from so no wait of that life can pass for one of this
+    BasicRepeatingTimer(timer_type&& timer,
+                        TimerPeriod period,
+                        std::shared_ptr<Context> ctx,
+                        AnchorRef anchor = AnchorRef(),
+                        std::uint64_t generation = 0)
+        : generation_(generation),
+          running_(true),
+          context_(take_context(std::move(ctx))),
+          anchor_(anchor ? std::move(anchor) : AnchorRef(Policy::single_thread ? this : nullptr)),
+          timer_(std::move(timer))
+    {
+        set_period(period);
+        if constexpr (Policy::stats)
+            measure_.enabled = Policy::stats_on_create;
+    }
+
+    // Deleted copy/move to avoid accidental misuse
+    BasicRepeatingTimer(const BasicRepeatingTimer&) = delete;
+    BasicRepeatingTimer& operator=(const BasicRepeatingTimer&) = delete;
+    BasicRepeatingTimer(BasicRepeatingTimer&&) = delete;
+    BasicRepeatingTimer& operator=(BasicRepeatingTimer&&) = delete;
+
+    // Timer and context in one allocation, defined below the class
+    struct InlineSlot;
+
+    friend class TimerPool<BasicRepeatingTimer>;
+    // Lets test/benchmark.cpp run the tick handler body without the reactor around it
+    friend struct TimerTickProbe;
+
+    // Back to the state of a new idle timer for a TimerPool, only the asio timer and the anchor
+    // are kept. The timer comes back at the same address, so the anchor still points at it.
+    void recycle()
+    {
+        cancel();
+        timer_type kept(std::move(timer_));
+        AnchorRef anchor(std::move(anchor_));
+        const auto generation = (generation_.load() & ~busy) + 2;
+        this->~BasicRepeatingTimer();
+        new (this) BasicRepeatingTimer(std::move(kept), TimerPeriod(), nullptr, std::move(anchor), generation);
+    }
+
+    static std::shared_ptr<BasicRepeatingTimer> start(
+        std::shared_ptr<BasicRepeatingTimer> timer,
+        Handler handler,
+        Callback cb_once,
+        Callback cb_last,
+        WarmUp warm_up)
+    {
+        timer->handler_ = std::move(handler);
+        timer->call_first_ = static_cast<bool>(cb_once);
+        timer->callfirst_ = std::move(cb_once);
+        timer->calllast_ = std::move(cb_last);
+        // Queued before the first wait is, so it runs ahead of the first tick
+        timer->warm(warm_up);
+
+        // Initialise the timer's expiry and the epoch of the schedule to now
+        timer->epoch_ = Clock::now();
+        timer->timer_.expires_at(timer->epoch_);
+        timer->arm_next();               // start the loop
+        return timer;
+    }
+
+    using mutex_type = typename Policy::mutex_type;
+    template <typename T>
+    using atomic_t = typename Policy::template atomic_type<T>;
+
+    // The low bit of generation_ is set while a tick (or a dry run) holds the timer, the rest
+    // counts reschedules. Only the holder runs the callback or touches the measurements, so
+    // two ticks are never in flight at once, whatever the number of io threads.
+    static constexpr std::uint64_t busy = 1;
+
+    // Take the timer for the tick of generation `gen`, fails for a wait a reschedule
+    // superseded and while someone else holds it
+    bool claim(std::uint64_t gen)
+    {
+        auto expected = gen;
+        return generation_.compare_exchange_strong(expected, gen | busy);
+    }
+
+    // Give the timer back after holding it for generation `gen`, sched_mtx_ must be held.
+    // With `next` the following tick is armed, a schedule a reschedule left to the holder
+    // is armed either way.
+    void release(std::uint64_t gen, bool next)
+    {
+        const auto now = generation_.load();
+        generation_.store(now & ~busy);
+        if (next || now != (gen | busy))
+            arm_next();
+    }
+
+    // Cancel the pending wait and start a new schedule with its first tick at `anchor` + `first`,
+    // sched_mtx_ must be held. Later ticks follow the saved period from there. The new
+    // generation makes a wait that already completed leave the new schedule alone, a tick
+    // running on another thread arms it when it finishes.
+    void rearm(time_point anchor, typename Clock::duration first)
+    {
+        const auto held = generation_.fetch_add(2) & busy;
+        timer_.cancel();
+        if (!running_)
+            return;
+        if (!aligned()) {
+            epoch_ = anchor + first;
+            index_ = 0;
+            restart_ = true;
+        }
+        if (!held)
+            arm_next();
+    }
+
+    // sched_mtx_ must be held, or the timer not yet shared
+    void arm_next()
+    {
+        // Don't do anything if we've been cancelled
+        if (!running_)
+            return;
+
+        // Reset the timer and add a lambda to run when it expires
+        // There is once case with `callfirst_` if it is true don't add the period
+        // which ensures the timer will fire as soon as the async context schedules it
+        if (restart_) {
+            // The first tick of a rescheduled timer is the epoch itself
+            restart_ = false;
+            arm(epoch_ + draw_jitter());
+        }
+        else if(call_first_) {
+            arm(timer_.expiry());
+        }
+        else if (aligned()) {
+            if constexpr (Policy::align) {
+                this->boundary_ = next_boundary();
+                arm(this->boundary_ + draw_jitter());
+            }
+        }
+        else {
+            // Worked out from the epoch, never by adding to the last expiry, so neither
+            // rounding of fractional periods nor jitter can accumulate
+            arm(epoch_ + offset_of(++index_) + draw_jitter());
+        }
+    }
+
+    void arm(time_point deadline)
+    {
+        timer_.expires_at(deadline);
+        wait(deadline);
+    }
+
+    // References to this timer for pending handlers and their locks, the tick path takes
+    // them only through these so TimerInstrumentation sees every one
+    std::weak_ptr<BasicRepeatingTimer> weak_self()
+    {
+        TimerInstrumentation::count_refcount();
+        return this->weak_from_this();
+    }
+
+    static std::shared_ptr<BasicRepeatingTimer> lock_self(const std::weak_ptr<BasicRepeatingTimer>& wptr)
+    {
+        auto self = wptr.lock();
+        if (self)
+            TimerInstrumentation::count_refcount();
+        return self;
+    }
+
+    // The handler carries its deadline, the tick reads it from there rather than from timer_
+    void wait(time_point due)
+    {
+        if constexpr (Policy::single_thread) {
+            // Same thread as the destructor, the anchor only needs to say if the timer is alive
+            timer_.async_wait([anchor = anchor_, gen = generation_.load(), due](const asio::error_code& ec)
+            {
+                if (ec == asio::error::operation_aborted)
+                    return;                // cancelled
+                if (ec)
+                {
+                    std::cerr << "RepeatingTimer error: " << ec.message() << '\n';
+                    return;
+                }
+                if (auto* self = anchor.get()) {
+                    TimerInstrumentation::count_tick();
+                    self->run_tick(gen, due);
+                }
+            });
+            return;
+        }
+        // Use a weak pointer to pass a reference to the owning object into the lambda
+        // inside it, if you can't lock the weak pointer then the object is no longer referenced
+        // Taken straight from the weak self reference, one count up instead of three
+        timer_.async_wait([wptr = weak_self(), gen = generation_.load(), due](const asio::error_code& ec)
+        {
+            if (ec == asio::error::operation_aborted)
+                return;                    // cancelled
+            if (ec)
+            {
+                std::cerr << "RepeatingTimer error: " << ec.message() << '\n';
+                return;
+            }
+            // Make sure that the timer object is still referenced
+            if(auto self = lock_self(wptr)) {
+                TimerInstrumentation::count_tick();
+                self->run_tick(gen, due);
+            }
+        });
+    }
+
+    // Runs the tick, or defers it behind the waiting completions once the thread's budget is spent.
+    // A wait that completed just before a reschedule cancelled it belongs to an old generation.
+    void run_tick(std::uint64_t gen, time_point due)
+    {
+        auto found = gen;
+        if (!generation_.compare_exchange_strong(found, gen | busy)) {
+            // A dry run holds the timer, the tick goes in behind it
+            if (found == (gen | busy)) {
+                asio::post(timer_.get_executor(), [wptr = weak_self(), gen, due]()
+                {
+                    if (auto self = lock_self(wptr))
+                        self->run_tick(gen, due);
+                });
+            }
+            return;
+        }
+        run_claimed(gen, due);
+    }
+
+    // The timer is held for this tick from here until finish_tick(). set_budget() may change
+    // the budget from another thread at any time, the tick reads it once and sticks to that one.
+    void run_claimed(std::uint64_t gen, time_point due)
+    {
+        if constexpr (Policy::budgets) {
+            if (TickBudget* const budget = this->budget_.load(std::memory_order_acquire)) {
+                if (!budget->admit())
+                    defer_tick(gen, due, *budget);
+                else
+                    budgeted_tick(gen, due, *budget);
+                return;
+            }
+        }
+        tick(gen, due);
+    }
+
+    void budgeted_tick(std::uint64_t gen, time_point due, TickBudget& budget)
+    {
+        const auto started = std::chrono::steady_clock::now();
+        tick(gen, due);
+        budget.charge(std::chrono::steady_clock::now() - started);
+    }
+
+    void defer_tick(std::uint64_t gen, time_point due, TickBudget& budget)
+    {
+        budget.defer();
+        asio::post(timer_.get_executor(), [wptr = weak_self(), gen, due, budget = &budget]()
+        {
+            auto self = lock_self(wptr);
+            if (!self || !self->running_)
+                return;
+            // A fresh round on the budget that deferred the tick
+            budget->resume();
+            self->run_claimed(gen, due);
+        });
+    }
+
+    // Expiry handler body, runs the callbacks then re-arms
+    void tick(std::uint64_t gen, time_point due)
+    {
+        if constexpr (Policy::stats) {
+            if (measure_.changed.load(std::memory_order_acquire))
+                apply_settings();
+        }
+        const bool measure = measuring();
+        bool slo = false;
+        if constexpr (Policy::stats) {
+            const auto* tuning = measure_.tuning.load(std::memory_order_relaxed);
+            slo = tuning && tuning->slo.active();
+        }
+        // One clock read serves the stats, the offload average, the SLO and the TickInfo
+        time_point started;
+        if (measure || slo || kind() == HandlerKind::with_info)
+            started = Clock::now();
+        const TickInfo info = make_tick_info(due, started);
+        if constexpr (Policy::stats) {
+            if (slo)
+                check_slo(info.index, started - info.scheduled);
+            // A callback measured to be slow runs on the offload executor instead
+            if (measure_.offloaded && !call_first_ && has_callback()) {
+                measure_.lateness = started - info.scheduled;
+                post_offloaded(info, gen);
+                return;
+            }
+        }
+        bool finished = true;
+        bool held = false;
+        // Guard the context against concurrent access, if a context is set
+        {
+            std::unique_lock<mutex_type> lock(context_mtx_, std::defer_lock);
+            if (has_context())
+                lock.lock();
+            // If callfirst_ is callable do it now ... then destroy it
+            // So .. call first and never again.
+            if (call_first_) {
+                call(callfirst_);
+                callfirst_ = nullptr;
+                call_first_ = false;
+            }
+            else if (Policy::sliced && kind() == HandlerKind::sliced)
+                finished = run_slice();
+            else if (Policy::async && kind() == HandlerKind::async)
+                held = !start_async();
+            else
+                invoke_callback(info);
+        }
+        if constexpr (Policy::stats) {
+            if (measure) {
+                const auto finished_at = Clock::now();
+                measure_.lateness = started - info.scheduled;
+                measure_.cost = finished_at - started;
+                update_offload();
+            }
+        }
+        // A sliced callback that yielded re-arms once its last slice is done
+        if (!finished) {
+            post_slice(gen);
+            return;
+        }
+        // A held async tick keeps the timer until a call completes, the later of the two resumes
+        if constexpr (Policy::async) {
+            if (held) {
+                if (this->held_.fetch_and(~held_tick) == held_tick)
+                    resume_async();
+                return;
+            }
+        }
+        finish_tick(gen, measure);
+    }
+
+    // Give the timer back and arm the next tick, the one time a tick takes sched_mtx_.
+    // The figures are taken first, once released the next tick may already be running.
+    void finish_tick(std::uint64_t gen, bool publish)
+    {
+        std::lock_guard<mutex_type> l(sched_mtx_);
+        const TimerStats figures = publish ? tick_stats() : TimerStats{};
+        release(gen, true);
+        if (publish)
+            publish_stats(figures);
+    }
+
+    // Lateness and cost are wanted this tick, for the stats or the offload average
+    bool measuring() const
+    {
+        if constexpr (Policy::stats)
+            return measure_.enabled.load(std::memory_order_relaxed) || measure_.offload_threshold.count();
+        else
+            return false;
+    }
+
+    // held_ while an async tick is held: the tick hasn't returned yet, no call has completed yet
+    static constexpr unsigned held_tick = 1;
+    static constexpr unsigned held_call = 2;
+
+    // Start an async call if the limit allows, false when the tick is held until a call completes
+    bool start_async()
+    {
+        if constexpr (Policy::async) {
+            auto& async = *std::get_if<AsyncCallback>(&handler_);
+            if (this->max_in_flight_ == fixed_delay) {
+                // Held before the call, the completion may come back before it returns
+                this->in_flight_.fetch_add(1);
+                this->held_.store(held_tick | held_call);
+                call(async, Done(weak_self()));
+                return false;
+            }
+            if (this->in_flight_.fetch_add(1) >= this->max_in_flight_) {
+                this->in_flight_.fetch_sub(1);
+                this->held_.store(held_tick | held_call);
+                // A call may have completed before held_ was set, that one counts then
+                if (this->in_flight_.load() < this->max_in_flight_)
+                    this->held_.fetch_and(~held_call);
+                return false;
+            }
+            call(async, Done(weak_self()));
+        }
+        return true;
+    }
+
+    // An async call completed, runs on the timer's executor
+    void async_done()
+    {
+        if constexpr (Policy::async) {
+            this->in_flight_.fetch_sub(1);
+            if (this->held_.fetch_and(~held_call) == held_call && running_)
+                resume_async();
+        }
+    }
+
+    // Give the timer back after a held tick and restart the schedule from now, a fixed delay
+    // waits a period, a held tick runs straight away. A reschedule meanwhile set its own.
+    void resume_async()
+    {
+        std::lock_guard<mutex_type> l(sched_mtx_);
+        const bool publish = measuring();
+        const TimerStats figures = publish ? tick_stats() : TimerStats{};
+        generation_.store(generation_.load() & ~busy);
+        const bool due_now = !restart_ && this->max_in_flight_ != fixed_delay;
+        if (!restart_) {
+            epoch_ = Clock::now();
+            index_ = 0;
+        }
+        if (due_now && running_)
+            arm(epoch_);
+        else
+            arm_next();
+        if (publish)
+            publish_stats(figures);
+    }
+
+    // `now` is only meaningful when a TickInfo callback is set. Only the tick holding the timer
+    // calls this, ticks_ is its own.
+    TickInfo make_tick_info(time_point due, time_point now)
+    {
+        TickInfo info;
+        info.scheduled = due;
+        info.actual = now;
+        info.index = ticks_++;
+        const auto step = period();
+        if (kind() == HandlerKind::with_info && step.count() > 0 && now > info.scheduled)
+            info.missed = static_cast<std::uint64_t>((now - info.scheduled) / step);
+        return info;
+    }
+
+    HandlerKind kind() const { return static_cast<HandlerKind>(handler_.index()); }
+
+    // A plain or TickInfo callback is set, the kinds a dry run or the offload executor can call
+    bool has_callback() const
+    {
+        return kind() == HandlerKind::plain || kind() == HandlerKind::with_info;
+    }
+
+    void invoke_callback(const TickInfo& info)
+    {
+        if (auto* cb = std::get_if<Callback>(&handler_))
+            call(*cb);
+        else if (auto* tick_cb = std::get_if<TickCallback>(&handler_))
+            call(*tick_cb, info);
+    }
+
+    // One slice of a sliced callback, true once it reports done. The caller holds the context lock.
+    bool run_slice()
+    {
+        if constexpr (Policy::sliced) {
+            const SliceBudget budget(std::chrono::steady_clock::now() + this->slice_budget_);
+            return call(*std::get_if<SlicedCallback>(&handler_), budget) == Slice::done;
+        }
+        else
+            return true;
+    }
+
+    // Queue the next slice behind whatever else is waiting on the executor, the timer stays held
+    void post_slice(std::uint64_t gen)
+    {
+        asio::post(timer_.get_executor(), [wptr = weak_self(), gen]()
+        {
+            auto self = lock_self(wptr);
+            if (!self || !self->running_)
+                return;
+            bool done;
+            {
+                std::unique_lock<mutex_type> lock(self->context_mtx_, std::defer_lock);
+                if (self->has_context())
+                    lock.lock();
+                done = self->run_slice();
+            }
+            if (!done) {
+                self->post_slice(gen);
+                return;
+            }
+            self->finish_tick(gen, self->measuring());
+        });
+    }
+
+    // Run one tick on the offload executor, re-arm back on the timer's executor when done.
+    // The timer stays held throughout.
+    void post_offloaded(const TickInfo& info, std::uint64_t gen)
+    {
+        // Tracked so the io_context doesn't run out of work while the tick is away
+        auto home = asio::prefer(timer_.get_executor(), asio::execution::outstanding_work.tracked);
+        asio::post(measure_.tuning.load(std::memory_order_relaxed)->offload_executor, [wptr = weak_self(), home, info, gen]()
+        {
+            auto self = lock_self(wptr);
+            if (!self || !self->running_)
+                return;
+            const auto started = Clock::now();
+            {
+                std::unique_lock<mutex_type> lock(self->context_mtx_, std::defer_lock);
+                if (self->has_context())
+                    lock.lock();
+                self->invoke_callback(info);
+            }
+            self->measure_.cost = Clock::now() - started;
+            self->update_offload();
+            asio::post(home, [wptr = self->weak_self(), gen]()
+            {
+                auto self = lock_self(wptr);
+                if (!self || !self->running_)
+                    return;
+                self->finish_tick(gen, self->measuring());
+            });
+        });
+    }
+
+    // Fold the last callback cost into the average and move the callback if it crossed over
+    void update_offload()
+    {
+        if (!measure_.offload_threshold.count())
+            return;
+        // A threshold was set through tune(), so the tuning is there
+        auto& ewma = measure_.tuning.load(std::memory_order_relaxed)->cost_ewma;
+        ewma += (measure_.cost - ewma) / 8;
+        if (!measure_.offloaded && ewma > measure_.offload_threshold)
+            measure_.offloaded = true;
+        else if (measure_.offloaded && ewma < measure_.offload_threshold / 2)
+            measure_.offloaded = false;
+    }
+
+    // Queue a change to the measurement state, the next tick applies it while it holds the
+    // timer so it never lands halfway through a tick running on another thread
+    void change_settings(typename TimerMeasureState<true>::Setting setting)
+    {
+        std::lock_guard<mutex_type> l(sched_mtx_);
+        measure_.pending.push_back(std::move(setting));
+        measure_.changed.store(true, std::memory_order_release);
+    }
+
+    // Only called by the tick holding the timer
+    void apply_settings()
+    {
+        std::vector<typename TimerMeasureState<true>::Setting> settings;
+        {
+            std::lock_guard<mutex_type> l(sched_mtx_);
+            settings.swap(measure_.pending);
+            measure_.changed.store(false, std::memory_order_relaxed);
+        }
+        for (auto& apply : settings)
+            apply(measure_);
+    }
+
+    // Count this tick against the SLO, tell the hook about a late tick or a crossing
+    void check_slo(std::uint64_t tick, typename Clock::duration lateness)
+    {
+        auto& tuning = *measure_.tuning.load(std::memory_order_relaxed);
+        auto& slo = tuning.slo;
+        const auto late_by = std::chrono::duration_cast<std::chrono::nanoseconds>(lateness);
+        const bool late = late_by > slo.threshold();
+        const bool crossed = slo.record(late);
+        if (!tuning.slo_hook)
+            return;
+        if (late)
+            tuning.slo_hook(SloReport{SloEvent::violation, tick, late_by, slo.late_fraction()});
+        if (crossed)
+            tuning.slo_hook(SloReport{slo.breached() ? SloEvent::breached : SloEvent::recovered,
+                                        tick, late_by, slo.late_fraction()});
+    }
+
+    // Uniform in [-max, +max], zero when jitter is off
+    typename Clock::duration draw_jitter() const
+    {
+        if constexpr (Policy::jitter) {
+            const auto max = this->jitter_.load(std::memory_order_relaxed);
+            if (max > 0) {
+                const auto span = static_cast<std::uint64_t>(max) * 2 + 1;
+                return typename Clock::duration(static_cast<typename Clock::rep>(jitter_random() % span) - max);
+            }
+        }
+        return typename Clock::duration(0);
+    }
+
+    // splitmix64, one state per thread so ticks on different threads never share a cache line
+    static std::uint64_t jitter_random()
+    {
+        thread_local std::uint64_t state =
+            std::random_device{}() ^ std::hash<std::thread::id>{}(std::this_thread::get_id());
+        std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // The first multiple of the period (shifted by the offset) after now on Clock, and after
+    // the boundary of the last tick. A tick jittered early runs before its boundary, counting
+    // from now would arm the same boundary again. A clock set back by more than a period
+    // counts from now, so the schedule still snaps onto the new time.
+    time_point next_boundary() const
+    {
+        const auto step = period();
+        const auto now = Clock::now();
+        if (step.count() <= 0)
+            return now;
+        const auto boundary = this->boundary_;
+        const auto from = (now < boundary && boundary - now <= step) ? boundary : now;
+        const auto since = from.time_since_epoch() - this->align_offset_;
+        return time_point((since / step + 1) * step + this->align_offset_);
+    }
+
+    // Ticks go on the clock's boundaries, always false when the policy compiled alignment out
+    bool aligned() const
+    {
+        if constexpr (Policy::align)
+            return this->aligned_.load(std::memory_order_acquire);
+        else
+            return false;
+    }
+
+    // A contextless timer keeps nothing of its context, not even a null pointer
+    struct Contextless {};
+    using context_ptr = std::conditional_t<std::is_void_v<Context>, Contextless, std::shared_ptr<Context>>;
+
+    static context_ptr take_context(std::shared_ptr<Context> ctx)
+    {
+        if constexpr (std::is_void_v<Context>)
+            return Contextless{};
+        else
+            return ctx;
+    }
+
+    bool has_context() const
+    {
+        if constexpr (std::is_void_v<Context>)
+            return false;
+        else
+            return context_ != nullptr;
+    }
+
+    // Calls `f` with the context first, unless the timer is contextless
+    template <typename F, typename... Args>
+    decltype(auto) call(F& f, Args&&... args)
+    {
+        if constexpr (std::is_void_v<Context>)
+            return f(std::forward<Args>(args)...);
+        else
+            return f(*context_, std::forward<Args>(args)...);
+    }
+
+    // An aligned period needs the policy's alignment, checked before a factory takes anything
+    static void check_period(TimerPeriod period)
+    {
+        if (period.align && !Policy::align)
+            throw std::invalid_argument("an aligned period needs a policy with align");
+    }
+
+    // Store the period as an exact number of clock ticks, `num / den` of them.
+    // An aligned period turns alignment on, before the first arm_next() from the factories.
+    void set_period(TimerPeriod period)
+    {
+        static_assert(Clock::period::num == 1, "clock ticks must divide a second");
+        check_period(period);
+        if constexpr (Policy::align) {
+            if (period.align) {
+                this->align_offset_ = std::chrono::duration_cast<typename Clock::duration>(period.align_offset);
+                this->boundary_ = time_point();
+                this->aligned_.store(true, std::memory_order_release);
+            }
+        }
+        std::uint64_t num = period.num * Clock::period::den;
+        std::uint64_t den = period.den;
+        const auto g = std::gcd(num, den);
+        if (g > 1) {
+            num /= g;
+            den /= g;
+        }
+        rate_num_ = num;
+        rate_den_ = den;
+        period_.store(static_cast<typename Clock::rep>(num / den), std::memory_order_relaxed);
+    }
+
+    // Rounded to whole clock ticks, for stats, alignment and TickInfo::missed
+    typename Clock::duration period() const
+    {
+        return typename Clock::duration(period_.load(std::memory_order_relaxed));
+    }
+
+    // A one-off delay on this clock, rounded down to whole ticks
+    static typename Clock::duration to_clock(TimerPeriod period)
+    {
+        return typename Clock::duration(static_cast<typename Clock::rep>(
+            period.num * Clock::period::den / period.den));
+    }
+
+    // Time from the epoch to tick `k`, floor(k * num / den) ticks split so it can't overflow
+    typename Clock::duration offset_of(std::uint64_t k) const
+    {
+        const std::uint64_t q = k / rate_den_;
+        const std::uint64_t r = k % rate_den_;
+        return typename Clock::duration(static_cast<typename Clock::rep>(
+            q * rate_num_ + r * rate_num_ / rate_den_));
+    }
+
+    // What the tick holding the timer measured
+    TimerStats tick_stats() const
+    {
+        TimerStats s;
+        if constexpr (Policy::stats) {
+            s.period = std::chrono::duration_cast<std::chrono::nanoseconds>(period());
+            s.ticks = ticks_;
+            s.last_lateness = measure_.lateness;
+            s.last_cost = measure_.cost;
+        }
+        return s;
+    }
+
+    // Adds the deadline just armed, sched_mtx_ must be held so publishes don't interleave
+    void publish_stats(TimerStats s)
+    {
+        if constexpr (Policy::stats) {
+            s.next_deadline = to_steady(timer_.expiry());
+            measure_.stats.publish(s);
+        }
+    }
+
+    // Stats are kept on the steady clock so timers on different clocks can be compared
+    static std::chrono::steady_clock::time_point to_steady(time_point t)
+    {
+        if constexpr (std::is_same_v<Clock, std::chrono::steady_clock>)
+            return t;
+        else
+            return std::chrono::steady_clock::now() + std::chrono::duration_cast<
+                std::chrono::steady_clock::duration>(t - Clock::now());
+    }
+
+    // Hot state first, what every tick reads or writes sits in the cache lines right after
+    // the enabled features' state, and right after an inline context (see InlineSlot).
+    // The schedule (timer_, the period, epoch_, index_, alignment) is shared between the
+    // tick handler and reschedules from other threads, sched_mtx_ guards it
+    atomic_t<std::uint64_t> generation_{0};   // see busy
+    atomic_t<bool> running_;
+    bool restart_ = false;   // the next tick is the first of a new schedule, at epoch_
+    bool call_first_ = false;   // callfirst_ is still to run, tested without touching it
+    // Empty without stats, locks or a context, they then share a word with the flags
+    TimerMeasureState<Policy::stats> measure_;
+    mutex_type sched_mtx_;
+    mutex_type context_mtx_;
+    context_ptr context_;
+    time_point epoch_{};
+    std::uint64_t index_ = 0;
+    std::uint64_t ticks_ = 0;
+    std::uint64_t rate_num_ = 0;
+    std::uint64_t rate_den_ = 1;
+    atomic_t<typename Clock::rep> period_{0};   // see period()
+    Handler handler_;
+    AnchorRef anchor_;
+    timer_type timer_;
+    // Cold, each runs once
+    Callback callfirst_;
+    Callback calllast_;
+};
+
+// The context is held in a base that is constructed before and destroyed after the timer,
+// so the last call cb still sees a live context. `context_` only aliases it, no ownership.
+// The base comes first, so the context ends right where the timer's hot state begins.
+template <typename Context, typename Clock, std::size_t CallbackCapacity, typename Policy>
+struct BasicRepeatingTimer<Context, Clock, CallbackCapacity, Policy>::InlineSlot
+    : private InlineContext<Context>, public BasicRepeatingTimer<Context, Clock, CallbackCapacity, Policy>
+{
+    template <typename Tuple>
+    InlineSlot(TimerExecutor io, TimerPeriod period, Tuple&& args)
+        : InlineContext<Context>(std::forward<Tuple>(args)),
+          BasicRepeatingTimer<Context, Clock, CallbackCapacity, Policy>(std::move(io), period,
+              std::shared_ptr<Context>(std::shared_ptr<Context>(), &this->value))
+    {}
+};
+
+/// The usual timer, on the steady clock.
+template <typename Context, std::size_t CallbackCapacity = default_callback_capacity,
+          typename Policy = DefaultTimerPolicy>
+using RepeatingTimer = BasicRepeatingTimer<Context, std::chrono::steady_clock, CallbackCapacity, Policy>;
+
+/// Timer on the wall clock, follows clock adjustments.
+template <typename Context, std::size_t CallbackCapacity = default_callback_capacity,
+          typename Policy = DefaultTimerPolicy>
+using SystemRepeatingTimer = BasicRepeatingTimer<Context, std::chrono::system_clock, CallbackCapacity, Policy>;
+
+#if defined(__linux__)
+/// Timer on the boot clock, time spent suspended counts towards the period.
+template <typename Context, std::size_t CallbackCapacity = default_callback_capacity,
+          typename Policy = DefaultTimerPolicy>
+using BootRepeatingTimer = BasicRepeatingTimer<Context, boot_clock, CallbackCapacity, Policy>;
+#endif
+
+/* Recycles timers of one type on one executor, for timers created and destroyed at a high rate.
+
+  A released timer is cancelled (its last call cb runs) and put on a free list with its
+  asio timer still constructed, the next `Timer::create(pool, ...)` pops it instead of
+  building a new one. The reference counts live in pool slots as well, so in steady state
+  a create and release only moves a timer between the pool and its user.
+  The pool must outlive every timer created from it. Its slots outlive it while the
+  cancelled waits of released timers still reference them.
+*/
+template <typename Timer>
+class TimerPool
+{
+public:
+    /// `reserve` idle timers are built up front, with `warm_up` they are also touched
+    /// so the first creates from the pool don't fault them in.
+    explicit TimerPool(TimerExecutor io, std::size_t reserve = 0, WarmUp warm_up = WarmUp::none)
+        : executor_(std::move(io.executor))
+    {
+        free_.reserve(reserve);
+        for (std::size_t i = 0; i < reserve; i++) {
+            free_.push_back(make_idle());
+            if (warm_up != WarmUp::none)
+                prefault_memory(free_.back(), sizeof(Timer));
+        }
+    }
+
+    ~TimerPool()
+    {
+        for (Timer* timer : free_)
+            delete timer;
+    }
+
+    TimerPool(const TimerPool&) = delete;
+    TimerPool& operator=(const TimerPool&) = delete;
+
+    /// Released timers waiting to be reused.
+    std::size_t idle() const
+    {
+        std::lock_guard<std::mutex> l(mtx_);
+        return free_.size();
+    }
+
+private:
+    friend Timer;
+
+    Timer* make_idle() { return new Timer(TimerExecutor(executor_), TimerPeriod(), nullptr); }
+
+    Timer* pop()
+    {
+        {
+            std::lock_guard<std::mutex> l(mtx_);
+            if (!free_.empty()) {
+                Timer* timer = free_.back();
+                free_.pop_back();
+                return timer;
+            }
+        }
+        return make_idle();
+    }
+
+    void push(Timer* timer)
+    {
+        std::lock_guard<std::mutex> l(mtx_);
+        free_.push_back(timer);
+    }
+
+    mutable std::mutex mtx_;
+    asio::any_io_executor executor_;
+    std::vector<Timer*> free_;
+    TimerArena blocks_;
+};
+
+/* Keeps track of a group of timers so they can be stopped together.
+
+  Only weak references are held, the timers still belong to whoever created them.
+  `stop_all()` returns straight away, each timer is cancelled and its last call cb runs
+  on the timer's own executor, so with several io threads they drain in parallel.
+*/
+class TimerRegistry
+{
+public:
+    TimerRegistry() = default;
+    TimerRegistry(const TimerRegistry&) = delete;
+    TimerRegistry& operator=(const TimerRegistry&) = delete;
+
+    /// One live timer as seen by `snapshot()`.
+    struct Snapshot
+    {
+        std::string name;
+        const void* timer;                 // identity only, do not dereference
+        TimerStats stats;
+    };
+
+    /// Register a timer, returns it so this can wrap `create()`.
+    /// A named timer collects TimerStats, `name` labels them in snapshots. An unnamed one is
+    /// only tracked for stop_all() and its ticks cost nothing extra, its stats stay zero
+    /// unless its policy or enable_stats() turned them on.
+    template <typename Timer>
+    std::shared_ptr<Timer> add(std::shared_ptr<Timer> timer, std::string name = {})
+    {
+        if (!timer)
+            return timer;
+        if (!name.empty())
+            timer->enable_stats();
+        std::lock_guard<std::mutex> l(mtx_);
+        // Drop entries of timers that died on their own before growing
+        if (entries_.size() == entries_.capacity())
+            prune();
+        entries_.push_back(Entry{
+            timer,
+            [](const std::shared_ptr<void>& t) {
+                auto timer = std::static_pointer_cast<Timer>(t);
+                asio::post(timer->get_executor(), [timer, t](){ timer->cancel(); });
+            },
+            [](const std::shared_ptr<void>& t) {
+                return static_cast<const Timer*>(t.get())->stats();
+            },
+            std::move(name)});
+        return timer;
+    }
+
+    /// Stop every registered timer. `on_drained` is called once all of the last call
+    /// callbacks have run, from the io thread that ran the final one.
+    /// Returns the number of timers being stopped.
+    std::size_t stop_all(std::function<void()> on_drained = nullptr)
+    {
+        std::vector<Entry> entries;
+        {
+            std::lock_guard<std::mutex> l(mtx_);
+            entries.swap(entries_);
+        }
+
+        std::vector<std::pair<std::shared_ptr<void>, Entry*>> live;
+        live.reserve(entries.size());
+        for (auto& entry : entries) {
+            if (auto timer = entry.timer.lock())
+                live.emplace_back(std::move(timer), &entry);
+        }
+
+        if (live.empty()) {
+            if (on_drained)
+                on_drained();
+            return 0;
+        }
+
+        // The drain state travels with every stop job, the last one out reports
+        auto drain = std::make_shared<Drain>(live.size(), std::move(on_drained));
+        for (auto& [timer, entry] : live) {
+            void* raw = timer.get();
+            std::shared_ptr<void> guard(raw, [drain, timer = std::move(timer)](void*) mutable {
+                timer.reset();
+                if (--drain->pending == 0 && drain->done)
+                    drain->done();
+            });
+            entry->stop(guard);
+        }
+        return live.size();
+    }
+
+    /// Stats of every live timer. Only the registry's own list is locked while copying,
+    /// each timer's figures are read without blocking its ticks.
+    std::vector<Snapshot> snapshot() const
+    {
+        std::vector<Entry> entries;
+        {
+            std::lock_guard<std::mutex> l(mtx_);
+            entries = entries_;
+        }
+
+        std::vector<Snapshot> result;
+        result.reserve(entries.size());
+        for (auto& entry : entries) {
+            if (auto timer = entry.timer.lock())
+                result.push_back(Snapshot{std::move(entry.name), timer.get(), entry.stats(timer)});
+        }
+        return result;
+    }
+
+    /// Number of registered timers that are still alive.
+    std::size_t size() const
+    {
+        std::lock_guard<std::mutex> l(mtx_);
+        std::size_t n = 0;
+        for (auto& entry : entries_) {
+            if (!entry.timer.expired())
+                ++n;
+        }
+        return n;
+    }
+
+private:
+    struct Entry
+    {
+        std::weak_ptr<void> timer;
+        void (*stop)(const std::shared_ptr<void>&);
+        TimerStats (*stats)(const std::shared_ptr<void>&);
+        std::string name;
+    };
+
+    struct Drain
+    {
+        Drain(std::size_t n, std::function<void()> cb) : pending(n), done(std::move(cb)) {}
+        std::atomic<std::size_t> pending;
+        std::function<void()> done;
+    };
+
+    void prune()
+    {
+        entries_.erase(
+            std::remove_if(entries_.begin(), entries_.end(),
+                [](const Entry& e) { return e.timer.expired(); }),
+            entries_.end());
+    }
+
+    mutable std::mutex mtx_;
+    std::vector<Entry> entries_;
+};
+
+#ifdef REPEATING_TIMER_COUNT_ALLOCATIONS
+// Replacement global allocation functions, feeding TimerInstrumentation
+#include <cstdlib>
+
+// GCC sees std::free on memory from operator new once these are inlined, but the replacement
+// operator new is the std::malloc above it, so the pair does match
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size)
+{
+    TimerInstrumentation::count_allocation(size);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+// Over-aligned types (alignas beyond max_align_t) come through these
+void* operator new(std::size_t size, std::align_val_t align)
+{
+    TimerInstrumentation::count_allocation(size);
+    const auto a = static_cast<std::size_t>(align);
+    // aligned_alloc wants a multiple of the alignment
+    if (void* p = std::aligned_alloc(a, (size + a - 1) / a * a + (size ? 0 : a)))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t align)
+{
+    return ::operator new(size, align);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+#endif
@@ -0,0 +1,250 @@
+/*
+* Copyright (c) 2025 Dean Sellers (dean@sellers.id.au)
+* SPDX-License-Identifier: MIT
+*/
+
+#pragma once
+
+#include "repeatable_timer.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+/// Counter totals of one profiled callback, zero where a counter is not available.
+struct PerfCounters
+{
+    std::uint64_t calls = 0;
+    // Hardware, usually missing inside VMs and containers
+    std::uint64_t cycles = 0;
+    std::uint64_t instructions = 0;
+    std::uint64_t cache_misses = 0;
+    // Software, available wherever perf_event_open is
+    std::uint64_t task_clock_ns = 0;
+    std::uint64_t context_switches = 0;
+    std::uint64_t page_faults = 0;
+};
+
+/* Attributes io thread cost to timers by sampling perf_event_open counters around callbacks.
+
+  `wrap()` returns a callback that reads the calling thread's counters before and after
+  the real one and adds the difference to the totals of `name`. Counters are opened per
+  thread on first use, hardware ones (cycles, instructions, cache misses) when the CPU and
+  perf_event_paranoid allow, software ones (task clock, context switches, page faults) as
+  the fallback. Each sampled call costs a few read() system calls, profile, don't ship.
+  On other platforms the wrapper only counts calls.
+*/
+class TimerProfiler
+{
+    struct Totals
+    {
+        explicit Totals(std::string n) : name(std::move(n)) {}
+        const std::string name;
+        std::atomic<std::uint64_t> calls{0};
+        std::atomic<std::uint64_t> cycles{0};
+        std::atomic<std::uint64_t> instructions{0};
+        std::atomic<std::uint64_t> cache_misses{0};
+        std::atomic<std::uint64_t> task_clock_ns{0};
+        std::atomic<std::uint64_t> context_switches{0};
+        std::atomic<std::uint64_t> page_faults{0};
+    };
+
+public:
+    /// Wrap `cb` (any callable, for example a RepeatingTimer callback) so every call is sampled.
+    template <typename F>
+    auto wrap(std::string name, F cb)
+    {
+        auto totals = std::make_shared<Totals>(std::move(name));
+        {
+            std::lock_guard<std::mutex> l(mtx_);
+            totals_.push_back(totals);
+        }
+        // Only callable the way `cb` is, so create() can still pick the right overload.
+        // Arguments are forwarded, the Done of an async callback is passed by value.
+        return [totals, cb = std::move(cb)](auto&&... args) mutable
+            -> std::invoke_result_t<F&, decltype(args)...> {
+            Sample sample(*totals);
+            return cb(std::forward<decltype(args)>(args)...);
+        };
+    }
+
+    /// Totals so far for every wrapped callback, in the order they were wrapped.
+    std::vector<std::pair<std::string, PerfCounters>> report() const
+    {
+        std::lock_guard<std::mutex> l(mtx_);
+        std::vector<std::pair<std::string, PerfCounters>> result;
+        result.reserve(totals_.size());
+        for (auto& t : totals_) {
+            PerfCounters c;
+            c.calls = t->calls.load(std::memory_order_relaxed);
+            c.cycles = t->cycles.load(std::memory_order_relaxed);
+            c.instructions = t->instructions.load(std::memory_order_relaxed);
+            c.cache_misses = t->cache_misses.load(std::memory_order_relaxed);
+            c.task_clock_ns = t->task_clock_ns.load(std::memory_order_relaxed);
+            c.context_switches = t->context_switches.load(std::memory_order_relaxed);
+            c.page_faults = t->page_faults.load(std::memory_order_relaxed);
+            result.emplace_back(t->name, c);
+        }
+        return result;
+    }
+
+    /// True when the calling thread could open the hardware counters.
+    static bool hardware_available() { return thread_counters().hardware.open(); }
+
+    /// True when the calling thread could open the software counters.
+    static bool software_available() { return thread_counters().software.open(); }
+
+private:
+#if defined(__linux__)
+    // One leader and its followers, read together with PERF_FORMAT_GROUP
+    class Group
+    {
+    public:
+        static constexpr int size = 3;
+
+        Group(std::uint32_t type, const std::uint64_t (&configs)[size])
+        {
+            for (int i = 0; i < size; i++) {
+                fds_[i] = open_counter(type, configs[i], i == 0 ? -1 : fds_[0], ids_[i]);
+                // A group without its leader is useless, followers are optional
+                if (fds_[0] < 0)
+                    return;
+            }
+        }
+
+        ~Group()
+        {
+            for (int fd : fds_) {
+                if (fd >= 0)
+                    ::close(fd);
+            }
+        }
+
+        Group(const Group&) = delete;
+        Group& operator=(const Group&) = delete;
+
+        bool open() const { return fds_[0] >= 0; }
+
+        // Current values in config order, missing followers read as zero
+        bool read(std::uint64_t (&values)[size]) const
+        {
+            std::uint64_t buf[1 + 2 * size] = {};
+            if (!open() || ::read(fds_[0], buf, sizeof(buf)) <= 0)
+                return false;
+            // With PERF_FORMAT_ID each value is followed by its id
+            const std::uint64_t nr = buf[0];
+            for (int i = 0; i < size; i++) {
+                values[i] = 0;
+                for (std::uint64_t j = 0; j < nr && j < size; j++) {
+                    if (fds_[i] >= 0 && buf[2 + 2 * j] == ids_[i])
+                        values[i] = buf[1 + 2 * j];
+                }
+            }
+            return true;
+        }
+
+    private:
+        static int open_counter(std::uint32_t type, std::uint64_t config, int leader, std::uint64_t& id)
+        {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = config;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
+            attr.exclude_hv = 1;
+            // Count the kernel side too if allowed, page faults and switches live there
+            int fd = -1;
+            for (int exclude_kernel = 0; exclude_kernel <= 1 && fd < 0; exclude_kernel++) {
+                attr.exclude_kernel = exclude_kernel;
+                fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+            }
+            if (fd >= 0 && ::ioctl(fd, PERF_EVENT_IOC_ID, &id) < 0) {
+                ::close(fd);
+                fd = -1;
+            }
+            return fd;
+        }
+
+        int fds_[size] = {-1, -1, -1};
+        std::uint64_t ids_[size] = {};
+    };
+
+    struct ThreadCounters
+    {
+        Group hardware{PERF_TYPE_HARDWARE,
+            {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES}};
+        Group software{PERF_TYPE_SOFTWARE,
+            {PERF_COUNT_SW_TASK_CLOCK, PERF_COUNT_SW_CONTEXT_SWITCHES, PERF_COUNT_SW_PAGE_FAULTS}};
+    };
+#else
+    struct Group
+    {
+        static constexpr int size = 3;
+        bool open() const { return false; }
+        bool read(std::uint64_t (&)[size]) const { return false; }
+    };
+
+    struct ThreadCounters
+    {
+        Group hardware;
+        Group software;
+    };
+#endif
+
+    static ThreadCounters& thread_counters()
+    {
+        thread_local ThreadCounters counters;
+        return counters;
+    }
+
+    // Reads the counters on construction and adds the difference on destruction
+    class Sample
+    {
+    public:
+        explicit Sample(Totals& totals)
+            : totals_(totals), counters_(thread_counters())
+        {
+            hw_ok_ = counters_.hardware.read(hw_);
+            sw_ok_ = counters_.software.read(sw_);
+        }
+
+        ~Sample()
+        {
+            totals_.calls.fetch_add(1, std::memory_order_relaxed);
+            std::uint64_t now[Group::size];
+            if (hw_ok_ && counters_.hardware.read(now)) {
+                totals_.cycles.fetch_add(now[0] - hw_[0], std::memory_order_relaxed);
+                totals_.instructions.fetch_add(now[1] - hw_[1], std::memory_order_relaxed);
+                totals_.cache_misses.fetch_add(now[2] - hw_[2], std::memory_order_relaxed);
+            }
+            if (sw_ok_ && counters_.software.read(now)) {
+                totals_.task_clock_ns.fetch_add(now[0] - sw_[0], std::memory_order_relaxed);
+                totals_.context_switches.fetch_add(now[1] - sw_[1], std::memory_order_relaxed);
+                totals_.page_faults.fetch_add(now[2] - sw_[2], std::memory_order_relaxed);
+            }
+        }
+
+        Sample(const Sample&) = delete;
+        Sample& operator=(const Sample&) = delete;
+
+    private:
+        Totals& totals_;
+        ThreadCounters& counters_;
+        std::uint64_t hw_[Group::size] = {};
+        std::uint64_t sw_[Group::size] = {};
+        bool hw_ok_ = false;
+        bool sw_ok_ = false;
+    };
+
+    mutable std::mutex mtx_;
+    std::vector<std::shared_ptr<Totals>> totals_;
+};
@@ -0,0 +1,131 @@
+/*
+* Copyright (c) 2025 Dean Sellers (dean@sellers.id.au)
+* SPDX-License-Identifier: MIT
+*/
+
+// Count refcount increments in the timer and every heap allocation in this program
+#define REPEATING_TIMER_INSTRUMENT
+#define REPEATING_TIMER_COUNT_ALLOCATIONS
+#include "repeatable_timer.hpp"
+#include <iostream>
+#include <thread>
+#include <chrono>
+
+/* Fails if a timer that has reached steady state allocates while ticking, or takes more
+  than the two references a tick needs (the pending handler's weak one and locking it) */
+int main() {
+
+    asio::io_context io;
+    auto timer = RepeatingTimer<int>::create(
+        io,
+        [](int& counter) { ++counter; },
+        std::chrono::milliseconds(1),
+        std::make_shared<int>(0)
+    );
+
+    // Run the io_context in its own thread
+    std::thread io_thread([&io]{ io.run(); });
+
+    // Warm up, the first ticks populate asio's per thread handler cache
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const auto before = TimerInstrumentation::read();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    const auto after = TimerInstrumentation::read();
+
+    timer.reset();  // stop the timer
+    io_thread.join();
+
+    const auto ticks = after.ticks - before.ticks;
+    const auto allocations = after.allocations - before.allocations;
+    const auto increments = after.refcount_increments - before.refcount_increments;
+    std::cout << "Steady state ticks " << ticks << '\n'
+              << "\tallocations " << allocations
+              << ", bytes " << (after.bytes - before.bytes) << '\n'
+              << "\trefcount increments per tick "
+              << (ticks ? static_cast<double>(increments) / ticks : 0.0) << std::endl;
+
+    if (ticks == 0 || allocations != 0) {
+        std::cout << "FAILED, ticking allocates." << std::endl;
+        return 1;
+    }
+    std::cout << "Ticking is allocation free." << std::endl;
+    if (increments > 2 * ticks) {
+        std::cout << "FAILED, ticks take extra references." << std::endl;
+        return 1;
+    }
+
+    // Over-aligned allocations go through the aligned operator new and are counted too
+    // Called directly, a new expression that is deleted straight away may be optimised out
+    const auto before_aligned = TimerInstrumentation::read().allocations;
+    ::operator delete(::operator new(64, std::align_val_t(64)), std::align_val_t(64));
+    if (TimerInstrumentation::read().allocations - before_aligned != 1) {
+        std::cout << "FAILED, over-aligned allocations aren't counted." << std::endl;
+        return 1;
+    }
+
+    // A context constructed inside the timer shares its allocation (and control block),
+    // arming the first wait costs the same either way
+    auto create_allocations = [](auto create) {
+        const auto before = TimerInstrumentation::read().allocations;
+        auto timer = create();
+        const auto allocations = TimerInstrumentation::read().allocations - before;
+        timer.reset();
+        return allocations;
+    };
+    const auto shared = create_allocations([&io] {
+        return RepeatingTimer<int>::create(io, [](int& counter) { ++counter; },
+            std::chrono::milliseconds(1), std::make_shared<int>(0));
+    });
+    const auto in_place = create_allocations([&io] {
+        return RepeatingTimer<int>::create(io, [](int& counter) { ++counter; },
+            std::chrono::milliseconds(1), std::in_place, std::make_tuple(0));
+    });
+    std::cout << "Create allocations, shared context " << shared
+              << ", inline context " << in_place << std::endl;
+    if (in_place >= shared) {
+        std::cout << "FAILED, inline context allocates separately." << std::endl;
+        return 1;
+    }
+
+    // A released timer goes back to the pool, creating the next one reuses it
+    TimerPool<RepeatingTimer<void>> pool(io);
+    create_allocations([&pool] {
+        return RepeatingTimer<void>::create(pool, [] {}, std::chrono::milliseconds(1));
+    });
+    const auto fresh = create_allocations([&io] {
+        return RepeatingTimer<void>::create(io, [] {}, std::chrono::milliseconds(1));
+    });
+    const auto pooled = create_allocations([&pool] {
+        return RepeatingTimer<void>::create(pool, [] {}, std::chrono::milliseconds(1));
+    });
+    std::cout << "Create allocations, new timer " << fresh << ", pooled timer " << pooled << std::endl;
+    if (pooled >= fresh) {
+        std::cout << "FAILED, pooled timers are not reused." << std::endl;
+        return 1;
+    }
+
+    // A single thread timer keeps the anchor its waits reach it through across recycles,
+    // so a create and release from the pool costs it no more than any other timer
+    auto cycle_allocations = [](auto create) {
+        const auto before = TimerInstrumentation::read().allocations;
+        create().reset();
+        return TimerInstrumentation::read().allocations - before;
+    };
+    using SingleThreadTimer = RepeatingTimer<void, default_callback_capacity, SingleThreadTimerPolicy>;
+    TimerPool<SingleThreadTimer> single_pool(io);
+    cycle_allocations([&single_pool] {
+        return SingleThreadTimer::create(single_pool, [] {}, std::chrono::milliseconds(1));
+    });
+    const auto pooled_cycle = cycle_allocations([&pool] {
+        return RepeatingTimer<void>::create(pool, [] {}, std::chrono::milliseconds(1));
+    });
+    const auto single_cycle = cycle_allocations([&single_pool] {
+        return SingleThreadTimer::create(single_pool, [] {}, std::chrono::milliseconds(1));
+    });
+    std::cout << "Create and release allocations, pooled timer " << pooled_cycle
+              << ", pooled single thread timer " << single_cycle << std::endl;
+    if (single_cycle > pooled_cycle) {
+        std::cout << "FAILED, recycling a single thread timer allocates." << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,148 @@
+/*
+* Copyright (c) 2025 Dean Sellers (dean@sellers.id.au)
+* SPDX-License-Identifier: MIT
+*/
+
+#include "repeatable_timer.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+/* Cost each policy preset adds to the tick handler, over the asio calls it can't avoid.
+
+  The handler body runs directly, claim to re-arm, with the io_context out of the way, so
+  neither asio's queue nor the reactor is in the figures. Re-arming still cancels one asio
+  wait and starts another, so the same two calls on a bare steady_timer are timed alongside
+  as the reference. Cancelled waits are drained between batches, outside the timing, and
+  each io_context holds an earlier wait of its own so asio never has to reset the reactor's
+  timeout, a syscall, when one is armed.
+  Every repeat runs one round of each, interleaved, and what's reported is the mean and
+  standard deviation over the repeats of each preset's time less the reference's time in
+  the same repeat, so drift in the machine's speed cancels out of the difference.
+*/
+
+struct TimerTickProbe
+{
+    template <typename Timer>
+    static void tick(Timer& timer, typename Timer::time_point due)
+    {
+        timer.run_tick(timer.generation_.load() & ~Timer::busy, due);
+    }
+};
+
+namespace {
+
+constexpr int batch = 1000;     // ticks between drains
+constexpr int batches = 100;    // per repeat
+constexpr int repeats = 30;
+
+using Nanos = std::chrono::duration<double, std::nano>;
+
+// An io_context with a wait at the head of its timer queue for the whole run
+struct Context
+{
+    asio::io_context io{ASIO_CONCURRENCY_HINT_UNSAFE};
+    asio::steady_timer head{io, std::chrono::minutes(5)};
+
+    Context() { head.async_wait([](const asio::error_code&) {}); }
+};
+
+// Time `batches` rounds of `batch` calls to `step`, draining `io` after each round
+template <typename Step>
+double ns_per_call(asio::io_context& io, Step&& step)
+{
+    std::chrono::steady_clock::duration elapsed{0};
+    for (int b = 0; b < batches; b++) {
+        const auto started = std::chrono::steady_clock::now();
+        for (int i = 0; i < batch; i++)
+            step();
+        elapsed += std::chrono::steady_clock::now() - started;
+        io.poll();   // the cancelled waits
+    }
+    return Nanos(elapsed).count() / (batches * batch);
+}
+
+// One timer of the preset, never run by its io_context. Each tick arms the next period out,
+// a period of 10 minutes keeps a run's worth of them behind the head wait and well inside
+// the clock's range.
+template <typename Policy>
+struct PolicyRun
+{
+    using Timer = RepeatingTimer<std::uint64_t, default_callback_capacity, Policy>;
+
+    Context context;
+    std::shared_ptr<Timer> timer = Timer::create(context.io, [](std::uint64_t& c) { c++; },
+                                                 std::chrono::minutes(10),
+                                                 std::make_shared<std::uint64_t>(0));
+    std::vector<double> over_reference;
+
+    double run()
+    {
+        const auto due = Timer::clock_type::now();
+        return ns_per_call(context.io, [&] { TimerTickProbe::tick(*timer, due); });
+    }
+};
+
+// The asio part of a re-arm on its own, cancel the pending wait and start another
+struct Reference
+{
+    Context context;
+    asio::steady_timer timer{context.io};
+
+    double run()
+    {
+        const auto due = std::chrono::steady_clock::now() + std::chrono::minutes(10);
+        return ns_per_call(context.io, [&] {
+            timer.expires_at(due);
+            timer.async_wait([](const asio::error_code&) {});
+        });
+    }
+};
+
+void report(const char* label, const std::vector<double>& ns)
+{
+    double mean = 0.0;
+    for (double x : ns)
+        mean += x;
+    mean /= static_cast<double>(ns.size());
+    double var = 0.0;
+    for (double x : ns)
+        var += (x - mean) * (x - mean);
+    var /= static_cast<double>(ns.size() - 1);
+    std::cout << '\t' << std::left << std::setw(24) << label << std::right << std::fixed
+              << std::setprecision(1) << std::setw(6) << mean << " ns +- "
+              << std::setw(4) << std::sqrt(var) << '\n';
+}
+
+} // namespace
+
+int main() {
+    Reference reference;
+    PolicyRun<DefaultTimerPolicy> def;
+    PolicyRun<LeanTimerPolicy> lean;
+    PolicyRun<SingleThreadTimerPolicy> single;
+    std::vector<double> reference_ns;
+
+    // One round first so caches and branch predictors are warm before anything counts
+    for (int r = -1; r < repeats; r++) {
+        const double base = reference.run();
+        const double d = def.run() - base;
+        const double l = lean.run() - base;
+        const double s = single.run() - base;
+        if (r < 0)
+            continue;
+        reference_ns.push_back(base);
+        def.over_reference.push_back(d);
+        lean.over_reference.push_back(l);
+        single.over_reference.push_back(s);
+    }
+
+    std::cout << "Tick handler cost over the asio re-arm, mean +- standard deviation of "
+              << repeats << " repeats of " << batches * batch << " ticks\n";
+    report("DefaultTimerPolicy", def.over_reference);
+    report("LeanTimerPolicy", lean.over_reference);
+    report("SingleThreadTimerPolicy", single.over_reference);
+    report("(asio re-arm itself)", reference_ns);
+}
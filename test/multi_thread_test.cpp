@@ -48,16 +48,15 @@ int main() {
     /* Now create a timer running in each thread in a new scope */
     {
         /* We need to a reference to each timer somewhere */
-        std::vector<std::shared_ptr<RepeatingTimer<timer_context>>> timers;
+        std::vector<std::shared_ptr<RepeatingTimer<void>>> timers;
         /* Create the timers */
         for(int i=1; i<=NUM_TIMERS; i++)
         {
-            /* Create a timer that prints a counter every 1 milli. */
-            auto timer = RepeatingTimer<timer_context>::create(
+            /* Create a contextless timer that prints a counter every 1 milli. */
+            auto timer = RepeatingTimer<void>::create(
                 io,
-                [lambda_ctx = timer_context(i), &my_counter](timer_context& c) mutable { my_counter++; lambda_ctx.on_timer(); },
-                std::chrono::milliseconds(1),
-                nullptr  /* Empty context */
+                [lambda_ctx = timer_context(i), &my_counter]() mutable { my_counter++; lambda_ctx.on_timer(); },
+                std::chrono::milliseconds(1)
             );
             /* Save the timer in our vector in the outer scope */
             timers.push_back(timer);
@@ -69,8 +68,11 @@ int main() {
         for(size_t i=1; i<=NUM_TIMERS; i++) {
             threads.push_back(std::thread ([&io]{ io.run();}));
         }
-        /* Let them all tick for a bit */
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        /* Let them all tick for a bit, restarting them together halfway
+        while the io threads are running their ticks */
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        RepeatingTimer<void>::reschedule_all(timers, std::chrono::milliseconds(1), true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
     }
 
     /* Once our timers are out of scope, they are stopped */
@@ -78,4 +80,180 @@ int main() {
         t.join();
     }
     std::cout << "Timers finished callback counter - " << my_counter << std::endl;
+
+    /* Same again, but the timers are stopped as a group */
+    {
+        asio::io_context reg_io;
+        TimerRegistry registry;
+        std::atomic<size_t> last_calls(0);
+        std::atomic<bool> drained(false);
+        my_counter = 0;
+
+        /* The timers still need an owner, the registry only tracks them */
+        std::vector<std::shared_ptr<RepeatingTimer<int>>> timers;
+        for(int i=1; i<=NUM_TIMERS; i++)
+        {
+            timers.push_back(registry.add(RepeatingTimer<int>::create(
+                reg_io,
+                [&my_counter](int&) { my_counter++; },
+                std::chrono::milliseconds(1),
+                std::make_shared<int>(i),
+                nullptr,
+                [&last_calls](int&) { last_calls++; }
+            )));
+        }
+        threads.clear();
+        for(size_t i=1; i<=NUM_TIMERS; i++) {
+            threads.push_back(std::thread ([&reg_io]{ reg_io.run();}));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        /* One call stops them all, the last callbacks run on the io threads */
+        registry.stop_all([&drained]{ drained = true; });
+        for(auto& t : threads) {
+            t.join();
+        }
+        std::cout << "Registry drained " << std::boolalpha << drained
+                  << ", last callbacks - " << last_calls << std::endl;
+    }
+
+    /* Tick budgets switched on and off from this thread while the timers tick on two io threads */
+    {
+        asio::io_context budget_io(2);
+        auto work = asio::make_work_guard(budget_io);
+        TickBudget budget(std::chrono::microseconds(10));
+        std::vector<std::shared_ptr<RepeatingTimer<void>>> timers;
+        for(int i=1; i<=4; i++)
+        {
+            timers.push_back(RepeatingTimer<void>::create(
+                budget_io,
+                []() {
+                    const auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(20);
+                    while (std::chrono::steady_clock::now() < until) {}
+                },
+                std::chrono::microseconds(100)
+            ));
+        }
+        threads.clear();
+        for(size_t i=1; i<=2; i++) {
+            threads.push_back(std::thread ([&budget_io]{ budget_io.run();}));
+        }
+        for(int i=0; i<1000; i++) {
+            for(auto& timer : timers) {
+                timer->set_budget(i % 2 ? &budget : nullptr);
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(30));
+        }
+        timers.clear();
+        work.reset();
+        for(auto& t : threads) {
+            t.join();
+        }
+        std::cout << "Budgets switched while ticking, ticks deferred " << (budget.deferred() > 0) << std::endl;
+    }
+
+    /* Lateness objectives replaced from this thread while the timers tick on two io threads,
+    a tick must never see a window halfway through being replaced */
+    {
+        asio::io_context slo_io(2);
+        auto work = asio::make_work_guard(slo_io);
+        std::atomic<size_t> reports(0);
+        std::vector<std::shared_ptr<RepeatingTimer<void>>> timers;
+        for(int i=1; i<=4; i++)
+        {
+            timers.push_back(RepeatingTimer<void>::create(
+                slo_io,
+                []() {},
+                std::chrono::microseconds(100)
+            ));
+        }
+        threads.clear();
+        for(size_t i=1; i<=2; i++) {
+            threads.push_back(std::thread ([&slo_io]{ slo_io.run();}));
+        }
+        for(int i=0; i<1000; i++) {
+            /* Every tick is late by a nanosecond, the window size keeps changing */
+            const auto window = static_cast<std::uint32_t>(1 + i % 100);
+            for(auto& timer : timers) {
+                timer->set_slo(LatencySlo{std::chrono::nanoseconds(1), 0.9, window},
+                               [&reports](const SloReport&) { reports++; });
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(30));
+        }
+        timers.clear();
+        work.reset();
+        for(auto& t : threads) {
+            t.join();
+        }
+        std::cout << "SLOs replaced while ticking, reports " << (reports > 0) << std::endl;
+    }
+
+    /* Offloading turned on and off from this thread while the timers tick on two io threads */
+    {
+        asio::io_context offload_io(2);
+        asio::thread_pool pool(2);
+        auto work = asio::make_work_guard(offload_io);
+        std::vector<std::shared_ptr<RepeatingTimer<void>>> timers;
+        for(int i=1; i<=4; i++)
+        {
+            timers.push_back(RepeatingTimer<void>::create(
+                offload_io,
+                []() {
+                    const auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(30);
+                    while (std::chrono::steady_clock::now() < until) {}
+                },
+                std::chrono::microseconds(100)
+            ));
+        }
+        threads.clear();
+        for(size_t i=1; i<=2; i++) {
+            threads.push_back(std::thread ([&offload_io]{ offload_io.run();}));
+        }
+        for(int i=0; i<1000; i++) {
+            for(auto& timer : timers) {
+                timer->offload_when_slow(pool.get_executor(), std::chrono::microseconds(i % 3 ? 10 : 0));
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(30));
+        }
+        timers.clear();
+        work.reset();
+        for(auto& t : threads) {
+            t.join();
+        }
+        pool.join();
+        std::cout << "Offloading switched while ticking" << std::endl;
+    }
+
+    /* A slow contextless callback (no context lock to hide behind) on two io threads,
+    rescheduled over and over while it runs. A tick must never start before the last ends */
+    {
+        asio::io_context slow_io(2);
+        std::atomic<int> inside(0);
+        std::atomic<int> overlaps(0);
+        auto timer = RepeatingTimer<void>::create(
+            slow_io,
+            [&inside, &overlaps]() {
+                if (inside.fetch_add(1))
+                    overlaps++;
+                const auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(500);
+                while (std::chrono::steady_clock::now() < until) {}
+                inside.fetch_sub(1);
+            },
+            std::chrono::microseconds(300)
+        );
+        threads.clear();
+        for(size_t i=1; i<=2; i++) {
+            threads.push_back(std::thread ([&slow_io]{ slow_io.run();}));
+        }
+        for(int i=0; i<1000; i++) {
+            timer->reschedule(std::chrono::milliseconds(0));
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        timer.reset();
+        for(auto& t : threads) {
+            t.join();
+        }
+        std::cout << "Rescheduled ticks never overlapped " << (overlaps == 0) << std::endl;
+        return overlaps == 0 ? 0 : 1;
+    }
 }
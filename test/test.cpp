@@ -4,9 +4,14 @@
 */
 
 #include "repeatable_timer.hpp"
+#include "repeatable_timer_perf.hpp"
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
 
 int main() {
 
@@ -191,5 +196,934 @@ int main() {
         std::cout << "\tTimer rescheduling done." << std::endl;
     }
 
+    // Test contexts constructed in place in an arena
+    {
+        std::cout << "Testing arena contexts.\n";
+        asio::io_context io;
+        TimerArena arena;
+        std::vector<std::shared_ptr<RepeatingTimer<int>>> timers;
+        for (int i = 0; i < 3; i++) {
+            // Create a timer every 10 millis, counter starts at i * 100
+            timers.push_back(RepeatingTimer<int>::create(
+                arena,
+                io,
+                [](int& counter) { ++counter; },
+                std::chrono::milliseconds(10),
+                std::make_tuple(i * 100),
+                nullptr,
+                [](int& counter) {
+                    std::cout << "\tCounter finished at " << counter << '\n';
+                }
+            ));
+        }
+        std::cout << "\tArena slots in use " << arena.in_use() << '\n';
+
+        // Over-aligned blocks come from the heap and have to go back there, not onto the slots
+        void* aligned = arena.allocate(16, 64);
+        const bool is_aligned = reinterpret_cast<std::uintptr_t>(aligned) % 64 == 0;
+        arena.deallocate(aligned, 16, 64);
+        std::cout << "\tOver-aligned block aligned " << is_aligned
+                  << ", arena slots in use " << arena.in_use() << '\n';
+
+        // Run the io_context in its own thread
+        std::thread io_thread([&io]{ io.run(); });
+
+        // Let them tick 5 times.
+        std::this_thread::sleep_for(std::chrono::milliseconds(55));
+        timers.clear();  // stop the timers, contexts go with them
+
+        io_thread.join();
+        std::cout << "\tArena slots in use " << arena.in_use() << '\n';
+
+        // The cancelled wait of a released timer still references its slot, here after the
+        // arena is gone too, until the io_context destroys the handler
+        asio::io_context late_io;
+        {
+            TimerArena short_lived;
+            auto timer = RepeatingTimer<int>::create(
+                short_lived,
+                late_io,
+                [](int& counter) { ++counter; },
+                std::chrono::milliseconds(10),
+                std::make_tuple(0)
+            );
+            late_io.run_for(std::chrono::milliseconds(35));
+            timer.reset();
+        }
+        late_io.restart();
+        late_io.run();
+        std::cout << "\tWaits outlived their arena" << '\n';
+        std::cout << "\tTimers in arena done." << std::endl;
+    }
+
+    // Test move-only callbacks
+    {
+        std::cout << "Testing move-only callbacks.\n";
+        asio::io_context io;
+        // The step size lives in a unique_ptr, std::function could not hold this lambda
+        auto step = std::make_unique<int>(2);
+        RepeatingTimer<int>::Callback cb =
+            [step = std::move(step)](int& counter) {
+                counter += *step;
+                std::cout << "\tTick #" << counter << '\n';
+            };
+        std::cout << "\tCallback stored inline " << std::boolalpha << cb.is_inline() << '\n';
+        auto timer = RepeatingTimer<int>::create(
+            io,
+            std::move(cb),
+            std::chrono::milliseconds(10),
+            std::make_shared<int>(0)  // initial counter value
+        );
+
+        // Run the io_context in its own thread
+        std::thread io_thread([&io]{ io.run(); });
+
+        // Let it tick 3 times.
+        std::this_thread::sleep_for(std::chrono::milliseconds(35));
+        timer.reset();  // stop the timer
+
+        io_thread.join();
+        std::cout << "\tTimer with move-only callback done." << std::endl;
+    }
+
+    // Test rescheduling a batch of timers together
+    {
+        std::cout << "Testing batch reschedule.\n";
+        asio::io_context io;
+        std::vector<std::shared_ptr<RepeatingTimer<int>>> timers;
+        for (int i = 1; i <= 3; i++) {
+            // Create timers that would only tick after a second
+            timers.push_back(RepeatingTimer<int>::create(
+                io,
+                [](int& counter) { ++counter; },
+                std::chrono::seconds(1),
+                std::make_shared<int>(0),  // initial counter value
+                nullptr,
+                [i](int& counter) {
+                    std::cout << "\tTimer " << i << " finished at " << counter << '\n';
+                }
+            ));
+        }
+
+        // Run the io_context in its own thread
+        std::thread io_thread([&io]{ io.run(); });
+
+        // Switch them all to 10 millis in one go
+        RepeatingTimer<int>::reschedule_all(timers, std::chrono::milliseconds(10), true);
+        // Let them tick 3 times.
+        std::this_thread::sleep_for(std::chrono::milliseconds(35));
+        // Then all to a deadline far beyond the test
+        RepeatingTimer<int>::reschedule_all(timers,
+            std::chrono::steady_clock::now() + std::chrono::seconds(10));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        timers.clear();  // stop the timers
+
+        io_thread.join();
+        std::cout << "\tBatch reschedule done." << std::endl;
+    }
+
+    // Test stats of registered timers
+    {
+        std::cout << "Testing timer stats.\n";
+        asio::io_context io;
+        TimerRegistry registry;
+        // Two timers every 10 and 20 millis, the registry keeps their stats
+        auto fast = registry.add(RepeatingTimer<int>::create(
+            io,
+            [](int& counter) { ++counter; },
+            std::chrono::milliseconds(10),
+            std::make_shared<int>(0)
+        ), "fast");
+        auto slow = registry.add(RepeatingTimer<int>::create(
+            io,
+            [](int& counter) { ++counter; },
+            std::chrono::milliseconds(20),
+            std::make_shared<int>(0)
+        ), "slow");
+        // Registered without a name only for stopping, it doesn't measure
+        TimerRegistry shutdown;
+        auto quiet = shutdown.add(RepeatingTimer<int>::create(
+            io,
+            [](int& counter) { ++counter; },
+            std::chrono::milliseconds(10),
+            std::make_shared<int>(0)
+        ));
+
+        // Run the io_context in its own thread
+        std::thread io_thread([&io]{ io.run(); });
+
+        // Let the fast one tick 5 times.
+        std::this_thread::sleep_for(std::chrono::milliseconds(55));
+        for (auto& timer : registry.snapshot()) {
+            std::cout << "\t" << timer.name
+                      << " period " << std::chrono::duration_cast<std::chrono::milliseconds>(timer.stats.period).count() << "ms"
+                      << " ticks " << timer.stats.ticks << '\n';
+        }
+        std::cout << "\tUnnamed timer measured " << std::boolalpha << (quiet->stats().ticks > 0) << '\n';
+        fast.reset();  // stop the timers
+        slow.reset();
+        quiet.reset();
+
+        io_thread.join();
+        std::cout << "\tTimer stats done." << std::endl;
+    }
+
+    // Test sliced callbacks sharing a thread with another timer
+    {
+        std::cout << "Testing sliced callbacks.\n";
+        struct Batch { int remaining = 0; int slices = 0; int done = 0; };
+        // A non-recursive context lock, the first slice runs under the tick's lock
+        struct PlainMutexPolicy : DefaultTimerPolicy { using mutex_type = std::mutex; };
+        using SlicedTimer = RepeatingTimer<Batch, default_callback_capacity, PlainMutexPolicy>;
+        asio::io_context io;
+        // Every 50 millis work through 100 items of 100 micros, in slices of 1 milli
+        auto sliced = SlicedTimer::create_sliced(
+            io,
+            [](Batch& b, const SliceBudget& budget) {
+                if (b.remaining == 0) {
+                    b.remaining = 100;
+                    b.slices = 0;
+                }
+                ++b.slices;
+                while (b.remaining > 0) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                    if (--b.remaining > 0 && budget.exhausted())
+                        return Slice::yield;
+                }
+                std::cout << "\tBatch #" << ++b.done << " done, sliced "
+                          << std::boolalpha << (b.slices > 1) << '\n';
+                return Slice::done;
+            },
+            std::chrono::milliseconds(50),
+            std::make_shared<Batch>(),
+            std::chrono::milliseconds(1)
+        );
+        // A 5 milli timer on the same thread keeps ticking between slices
+        auto fast = RepeatingTimer<int>::create(
+            io,
+            [](int& counter) { ++counter; },
+            std::chrono::milliseconds(5),
+            std::make_shared<int>(0),
+            nullptr,
+            [](int& counter) {
+                std::cout << "\tFast timer kept ticking " << std::boolalpha << (counter > 15) << '\n';
+            }
+        );
+
+        // Run the io_context in its own thread
+        std::thread io_thread([&io]{ io.run(); });
+
+        // Let the sliced one run twice.
+        std::this_thread::sleep_for(std::chrono::milliseconds(120));
+        sliced.reset();  // stop the timers
+        fast.reset();
+
+        io_thread.join();
+        std::cout << "\tSliced callbacks done." << std::endl;
+    }
+
+    // Test slow callbacks moving to a pool and back
+    {
+        std::cout << "Testing offload of slow callbacks.\n";
+        struct Work { std::thread::id io_thread; int ticks = 0; int offloaded = 0; bool inline_again = false; };
+        asio::io_context io;
+        asio::thread_pool pool(1);
+        auto work = std::make_shared<Work>();
+        // Every 10 millis, the first 10 ticks take 3 millis each, then they are cheap
+        auto timer = RepeatingTimer<Work>::create(
+            io,
+            [](Work& w) {
+                const bool on_io = std::this_thread::get_id() == w.io_thread;
+                if (!on_io)
+                    ++w.offloaded;
+                else if (w.offloaded)
+                    w.inline_again = true;
+                if (++w.ticks <= 10)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(3));
+            },
+            std::chrono::milliseconds(10),
+            work
+        );
+        timer->offload_when_slow(pool.get_executor(), std::chrono::milliseconds(1));
+
+        // Run the io_context in its own thread
+        std::thread io_thread([&io, work]{
+            work->io_thread = std::this_thread::get_id();
+            io.run();
+        });
+
+        // Let it tick about 40 times.
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        timer.reset();  // stop the timer
+
+        io_thread.join();
+        pool.join();
+        std::cout << "\tOffloaded while slow " << std::boolalpha << (work->offloaded > 0) << '\n';
+        std::cout << "\tBack inline when cheap " << work->inline_again << '\n';
+        std::cout << "\tOffload done." << std::endl;
+    }
+
+    // Test sampling perf counters around callbacks
+    {
+        std::cout << "Testing callback profiling.\n";
+        asio::io_context io;
+        TimerProfiler profiler;
+        // A timer every 10 millis with a callback that does a bit of work
+        auto timer = RepeatingTimer<std::vector<int>>::create(
+            io,
+            profiler.wrap("filler", [](std::vector<int>& v) {
+                v.assign(10000, static_cast<int>(v.size()));
+            }),
+            std::chrono::milliseconds(10),
+            std::make_shared<std::vector<int>>()
+        );
+        // Async callbacks take their Done by value, the wrapper has to forward it
+        using Async = RepeatingTimer<std::vector<int>>;
+        auto async = Async::create_async(
+            io,
+            profiler.wrap("async", [](std::vector<int>& v, Async::Done done) {
+                v.push_back(1);
+                done();
+            }),
+            std::chrono::milliseconds(10),
+            std::make_shared<std::vector<int>>()
+        );
+
+        // Run the io_context in its own thread
+        std::thread io_thread([&io]{ io.run(); });
+
+        // Let it tick 5 times.
+        std::this_thread::sleep_for(std::chrono::milliseconds(55));
+        timer.reset();  // stop the timer
+        async.reset();
+
+        io_thread.join();
+        for (auto& [name, counters] : profiler.report()) {
+            // The async one re-arms a period after each completion, its count depends on timing
+            if (name == "async")
+                std::cout << "\t" << name << " called " << (counters.calls > 0) << '\n';
+            else
+                std::cout << "\t" << name << " calls " << counters.calls << '\n';
+            // Which counters exist depends on the host, only check the task clock agrees with that
+            std::cout << "\tTask clock counted where available " << std::boolalpha
+                      << ((counters.task_clock_ns > 0) == TimerProfiler::software_available()) << '\n';
+        }
+        std::cout << "\tProfiling done." << std::endl;
+    }
+
+    // Test timers on a strand and on a thread pool
+    {
+        std::cout << "Testing executors.\n";
+        asio::io_context io;
+        asio::thread_pool pool(2);
+        // Two timers share a plain counter, their strand keeps them from overlapping
+        auto strand = asio::make_strand(io);
+        auto shared = std::make_shared<int>(0);
+        auto first = RepeatingTimer<int>::create(
+            strand, [](int& counter) { ++counter; }, std::chrono::milliseconds(10), shared);
+        auto second = RepeatingTimer<int>::create(
+            strand, [](int& counter) { ++counter; }, std::chrono::milliseconds(10), shared);
+        // And one straight on the thread pool
+        auto on_pool = RepeatingTimer<int>::create(
+            pool,
+            [](int& counter) { ++counter; },
+            std::chrono::milliseconds(10),
+            std::make_shared<int>(0),
+            nullptr,
+            [](int& counter) {
+                std::cout << "\tPool timer finished at " << counter << '\n';
+            }
+        );
+
+        // Run the io_context on several threads
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 3; i++) {
+            threads.emplace_back([&io]{ io.run(); });
+        }
+
+        // Let them tick 5 times.
+        std::this_thread::sleep_for(std::chrono::milliseconds(55));
+        first.reset();  // stop the timers
+        second.reset();
+        on_pool.reset();
+
+        for (auto& t : threads) {
+            t.join();
+        }
+        pool.join();
+        std::cout << "\tStrand timers counted " << *shared << '\n';
+        std::cout << "\tExecutors done." << std::endl;
+    }
+
+    // Test timers on other clocks
+    {
+        std::cout << "Testing clocks.\n";
+        asio::io_context io;
+        auto on_system = SystemRepeatingTimer<int>::create(
+            io,
+            [](int& counter) { ++counter; },
+            std::chrono::milliseconds(10),
+            std::make_shared<int>(0),
+            nullptr,
+            [](int& counter) {
+                std::cout << "\tSystem clock timer finished at " << counter << '\n';
+            }
+        );
+#if defined(__linux__)
+        auto on_boot = BootRepeatingTimer<int>::create(
+            io,
+            [](int& counter) { ++counter; },
+            std::chrono::milliseconds(10),
+            std::make_shared<int>(0),
+            nullptr,
+            [](int& counter) {
+                std::cout << "\tBoot clock timer finished at " << counter << '\n';
+            }
+        );
+#endif
+
+        // Run the io_context in its own thread
+        std::thread io_thread([&io]{ io.run(); });
+
+        // Let them tick 5 times.
+        std::this_thread::sleep_for(std::chrono::milliseconds(55));
+        on_system.reset();  // stop the timers
+#if defined(__linux__)
+        on_boot.reset();
+#endif
+
+        io_thread.join();
+        std::cout << "\tClocks done." << std::endl;
+    }
+
+    // Test ticks aligned to the wall clock
+    {
+        std::cout << "Testing aligned ticks.\n";
+        struct Offsets { int ticks = 0; std::chrono::milliseconds worst{0}; };
+        asio::io_context io;
+        auto offsets = std::make_shared<Offsets>();
+        // Every 10 millis, on the 10 milli boundaries of the system clock
+        auto timer = SystemRepeatingTimer<Offsets>::create(
+            io,
+            [](Offsets& o) {
+                const auto since = std::chrono::system_clock::now().time_since_epoch();
+                const auto offset = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    since % std::chrono::milliseconds(10));
+                ++o.ticks;
+                o.worst = std::max(o.worst, offset);
+            },
+            std::chrono::milliseconds(10),
+            offsets
+        );
+        timer->align();
+
+        // Run the io_context in its own thread
+        std::thread io_thread([&io]{ io.run(); });
+
+        // Let it tick 5 times.
+        std::this_thread::sleep_for(std::chrono::milliseconds(55));
+        timer.reset();  // stop the timer
+
+        io_thread.join();
+        std::cout << "\tTicked on the boundaries " << std::boolalpha
+                  << (offsets->ticks >= 4 && offsets->worst < std::chrono::milliseconds(5)) << '\n';
+
+        // Created aligned on an io_context that is already running, every 20 millis and 3 past
+        // the boundary, the first tick included
+        asio::io_context running_io;
+        auto work = asio::make_work_guard(running_io);
+        std::thread running_thread([&running_io]{ running_io.run(); });
+        auto first = std::make_shared<Offsets>();
+        auto created_aligned = SystemRepeatingTimer<Offsets>::create(
+            running_io,
+            [](Offsets& o) {
+                const auto since = std::chrono::system_clock::now().time_since_epoch();
+                const auto offset = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    (since - std::chrono::milliseconds(3)) % std::chrono::milliseconds(20));
+                if (o.ticks++ == 0)
+                    o.worst = offset;
+            },
+            TimerPeriod(std::chrono::milliseconds(20)).aligned(std::chrono::milliseconds(3)),
+            first
+        );
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        created_aligned.reset();  // stop the timer
+        work.reset();
+        running_thread.join();
+        std::cout << "\tFirst tick on a boundary "
+                  << (first->ticks >= 1 && first->worst < std::chrono::milliseconds(5)) << '\n';
+        std::cout << "\tAligned ticks done." << std::endl;
+    }
+
+    // Test random jitter on each tick
+    {
+        std::cout << "Testing jitter.\n";
+        struct Intervals {
+            int ticks = 0;
+            std::chrono::steady_clock::time_point last{};
+            std::chrono::steady_clock::duration shortest = std::chrono::hours(1);
+            std::chrono::steady_clock::duration longest{0};
+        };
+        asio::io_context io;
+        auto intervals = std::make_shared<Intervals>();
+        // Every 10 millis, give or take 3
+        auto timer = RepeatingTimer<Intervals>::create(
+            io,
+            [](Intervals& i) {
+                const auto now = std::chrono::steady_clock::now();
+                if (i.ticks++ > 0) {
+                    i.shortest = std::min(i.shortest, now - i.last);
+                    i.longest = std::max(i.longest, now - i.last);
+                }
+                i.last = now;
+            },
+            std::chrono::milliseconds(10),
+            intervals
+        );
+        timer->set_jitter(std::chrono::milliseconds(3));
+
+        // On 20 milli boundaries, give or take 6, an early tick mustn't re-arm its own boundary
+        auto aligned_ticks = std::make_shared<int>(0);
+        auto aligned = RepeatingTimer<int>::create(
+            io,
+            [](int& ticks) { ++ticks; },
+            std::chrono::milliseconds(20),
+            aligned_ticks
+        );
+        aligned->align();
+        aligned->set_jitter(std::chrono::milliseconds(6));
+
+        // Run the io_context in its own thread
+        std::thread io_thread([&io]{ io.run(); });
+
+        // Let it tick about 50 times.
+        std::this_thread::sleep_for(std::chrono::milliseconds(505));
+        timer.reset();  // stop the timers
+        aligned.reset();
+
+        io_thread.join();
+        std::cout << "\tIntervals varied " << std::boolalpha
+                  << (intervals->longest - intervals->shortest > std::chrono::milliseconds(1)) << '\n';
+        std::cout << "\tAverage period kept "
+                  << (intervals->ticks >= 48 && intervals->ticks <= 51) << '\n';
+        std::cout << "\tAligned period kept " << (*aligned_ticks >= 24 && *aligned_ticks <= 27) << '\n';
+        std::cout << "\tJitter done." << std::endl;
+    }
+
+    // Test callbacks receiving the tick info
+    {
+        std::cout << "Testing tick info.\n";
+        using Timer = RepeatingTimer<int>;
+        asio::io_context io;
+        // Every 10 millis, the second tick overruns by more than two periods
+        auto timer = Timer::create(
+            io,
+            [](int& counter, const Timer::TickInfo& info) {
+                if (info.index == 1)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(25));
+                if (info.missed)
+                    std::cout << "\tTick #" << info.index << " missed " << info.missed << '\n';
+                counter = static_cast<int>(info.index);
+            },
+            std::chrono::milliseconds(10),
+            std::make_shared<int>(0),
+            nullptr,
+            [](int& counter) {
+                std::cout << "\tLast tick index " << counter << '\n';
+            }
+        );
+
+        // Run the io_context in its own thread
+        std::thread io_thread([&io]{ io.run(); });
+
+        // Let it tick 5 times.
+        std::this_thread::sleep_for(std::chrono::milliseconds(55));
+        timer.reset();  // stop the timer
+
+        io_thread.join();
+        std::cout << "\tTick info done." << std::endl;
+    }
+
+    {
+        std::cout << "Testing fractional periods.\n";
+        asio::io_context io;
+
+        // 3 ticks every 10ms, a period of 3333333.33ns which no clock can hold
+        std::vector<std::chrono::steady_clock::time_point> scheduled;
+        auto timer = RepeatingTimer<int>::create(io,
+            [&scheduled](int&, const RepeatingTimer<int>::TickInfo& info) {
+                scheduled.push_back(info.scheduled);
+            },
+            TimerPeriod::per(3, std::chrono::milliseconds(10)),
+            std::make_shared<int>(0)
+        );
+
+        // Run the io_context in its own thread
+        std::thread io_thread([&io]{ io.run(); });
+
+        // Let it tick a little over 30 times.
+        std::this_thread::sleep_for(std::chrono::milliseconds(105));
+        timer.reset();  // stop the timer
+
+        io_thread.join();
+        // Rounding each period down would lose 10ns by now, the epoch keeps it exact
+        std::cout << "\t30 ticks took exactly 100ms "
+                  << (scheduled.size() > 30 && scheduled[30] - scheduled[0] == std::chrono::milliseconds(100))
+                  << '\n';
+        std::cout << "\tFractional periods done." << std::endl;
+    }
+
+    {
+        std::cout << "Testing async callbacks.\n";
+        asio::io_context io;
+
+        // Each call starts 25ms of "I/O", four times the period
+        struct Calls { int started = 0; int running = 0; int most = 0; };
+        auto start_io = [&io](Calls& calls, RepeatingTimer<Calls>::Done done) {
+            calls.started++;
+            calls.most = std::max(calls.most, ++calls.running);
+            auto io_timer = std::make_shared<asio::steady_timer>(io, std::chrono::milliseconds(25));
+            io_timer->async_wait([io_timer, &calls, done = std::move(done)](const asio::error_code&) mutable {
+                calls.running--;
+                done();
+            });
+        };
+        auto delayed_calls = std::make_shared<Calls>();
+        auto delayed = RepeatingTimer<Calls>::create_async(io, start_io,
+            std::chrono::milliseconds(5), delayed_calls);
+        auto limited_calls = std::make_shared<Calls>();
+        auto limited = RepeatingTimer<Calls>::create_async(io, start_io,
+            std::chrono::milliseconds(5), limited_calls, 2);
+
+        // Run the io_context in its own thread
+        std::thread io_thread([&io]{ io.run(); });
+
+        // Time for about 3 fixed delay calls.
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        delayed.reset();  // stop the timers
+        limited.reset();
+
+        io_thread.join();
+        std::cout << "\tFixed delay never overlapped " << (delayed_calls->most == 1)
+                  << ", calls " << (delayed_calls->started >= 2 && delayed_calls->started <= 4) << '\n';
+        std::cout << "\tLimited to 2 in flight " << (limited_calls->most == 2) << '\n';
+        std::cout << "\tAsync callbacks done." << std::endl;
+    }
+
+    {
+        std::cout << "Testing policies.\n";
+        asio::io_context io;
+
+        using LeanTimer = RepeatingTimer<int, default_callback_capacity, LeanTimerPolicy>;
+        using InstrumentedTimer = RepeatingTimer<int, default_callback_capacity, InstrumentedTimerPolicy>;
+        auto lean = LeanTimer::create(io, [](int& counter) { counter++; },
+            std::chrono::milliseconds(10), std::make_shared<int>(0));
+        auto instrumented = InstrumentedTimer::create(io, [](int& counter) { counter++; },
+            std::chrono::milliseconds(10), std::make_shared<int>(0));
+
+        // Run the io_context in its own thread
+        std::thread io_thread([&io]{ io.run(); });
+
+        // Let them tick 5 times.
+        std::this_thread::sleep_for(std::chrono::milliseconds(55));
+        std::cout << "\tLean timer smaller " << (sizeof(LeanTimer) < sizeof(RepeatingTimer<int>))
+                  << ", stats " << lean->stats().ticks << '\n';
+        // With every feature off a timer is little more than its asio timer and its three callbacks
+        using BareTimer = RepeatingTimer<void, default_callback_capacity, SingleThreadTimerPolicy>;
+        std::cout << "\tSingle thread timer in six cache lines " << (sizeof(BareTimer) <= 6 * 64) << '\n';
+        bool rejected = false;
+        try {
+            LeanTimer::create(io, [](int&) {}, TimerPeriod(std::chrono::milliseconds(10)).aligned(),
+                              std::make_shared<int>(0));
+        }
+        catch (const std::invalid_argument&) {
+            rejected = true;
+        }
+        std::cout << "\tAligned period needs align " << rejected << '\n';
+        std::cout << "\tInstrumented timer stats " << (instrumented->stats().ticks >= 5) << '\n';
+        lean.reset();  // stop the timers
+        instrumented.reset();
+
+        io_thread.join();
+        std::cout << "\tPolicies done." << std::endl;
+    }
+
+    {
+        std::cout << "Testing single thread policy.\n";
+        asio::io_context io(ASIO_CONCURRENCY_HINT_UNSAFE);
+
+        using LocalTimer = RepeatingTimer<int, default_callback_capacity, SingleThreadTimerPolicy>;
+        auto timer = LocalTimer::create(io,
+            [](int& counter) { counter++; },
+            std::chrono::milliseconds(10),
+            std::make_shared<int>(0),
+            nullptr,
+            [](int& counter) {
+                std::cout << "\tTimer finished at " << counter << '\n';
+            }
+        );
+
+        // Everything happens on the io thread, including the release of the timer
+        asio::steady_timer stop(io, std::chrono::milliseconds(55));
+        stop.async_wait([&timer](const asio::error_code&) { timer.reset(); });
+        io.run();
+        std::cout << "\tSingle thread policy done." << std::endl;
+    }
+
+    {
+        std::cout << "Testing inline contexts.\n";
+        asio::io_context io;
+
+        // Small POD state built inside the timer, no shared_ptr of its own
+        struct Counters { int ticks; int step; };
+        auto timer = RepeatingTimer<Counters>::create(
+            io,
+            [](Counters& c) { c.ticks += c.step; },
+            std::chrono::milliseconds(10),
+            std::in_place,
+            std::make_tuple(0, 2),
+            nullptr,
+            [](Counters& c) {
+                std::cout << "\tCounters finished at " << c.ticks << '\n';
+            }
+        );
+
+        // Run the io_context in its own thread
+        std::thread io_thread([&io]{ io.run(); });
+
+        // Let it tick 5 times.
+        std::this_thread::sleep_for(std::chrono::milliseconds(55));
+        timer.reset();  // stop the timer, the context goes with it
+
+        io_thread.join();
+        std::cout << "\tInline contexts done." << std::endl;
+    }
+
+    {
+        std::cout << "Testing contextless timers.\n";
+        asio::io_context io;
+
+        // The state lives in the lambda, the timer has no context at all, call first sets 100
+        int counter = 0;
+        auto timer = RepeatingTimer<void>::create(
+            io,
+            [&counter]() { ++counter; },
+            std::chrono::milliseconds(10),
+            [&counter]() { counter = 100; },
+            [&counter]() {
+                std::cout << "\tCounter finished at " << counter << '\n';
+            }
+        );
+
+        // Run the io_context in its own thread
+        std::thread io_thread([&io]{ io.run(); });
+
+        // Let it tick 5 times.
+        std::this_thread::sleep_for(std::chrono::milliseconds(55));
+        timer.reset();  // stop the timer
+
+        io_thread.join();
+        std::cout << "\tContextless timers done." << std::endl;
+    }
+
+    {
+        std::cout << "Testing timer pools.\n";
+        asio::io_context io;
+        TimerPool<RepeatingTimer<int>> pool(io, 2);
+        std::cout << "\tIdle timers " << pool.idle() << '\n';
+
+        // Run the io_context in its own thread, kept busy between the rounds
+        auto work = asio::make_work_guard(io);
+        std::thread io_thread([&io]{ io.run(); });
+
+        // Two rounds of three short lived timers, the second round reuses the first
+        for (int round = 1; round <= 2; round++) {
+            std::vector<std::shared_ptr<RepeatingTimer<int>>> timers;
+            for (int i = 0; i < 3; i++) {
+                timers.push_back(RepeatingTimer<int>::create(
+                    pool,
+                    [](int& counter) { ++counter; },
+                    std::chrono::milliseconds(10),
+                    std::make_shared<int>(round * 100),
+                    nullptr,
+                    [](int& counter) {
+                        std::cout << "\tCounter finished at " << counter << '\n';
+                    }
+                ));
+            }
+            // Let them tick 3 times.
+            std::this_thread::sleep_for(std::chrono::milliseconds(35));
+            timers.clear();  // stop the timers, back to the pool
+            std::cout << "\tIdle timers " << pool.idle() << '\n';
+        }
+
+        work.reset();
+        io_thread.join();
+
+        // Pooled slots stay valid for the cancelled waits of released timers after the pool
+        // is gone, and contextless timers need no context to come from a pool
+        asio::io_context late_io;
+        {
+            TimerPool<RepeatingTimer<void>> short_lived(late_io);
+            auto timer = RepeatingTimer<void>::create(
+                short_lived,
+                [] {},
+                std::chrono::milliseconds(10)
+            );
+            late_io.run_for(std::chrono::milliseconds(35));
+            timer.reset();
+        }
+        late_io.restart();
+        late_io.run();
+        std::cout << "\tWaits outlived their pool" << '\n';
+        std::cout << "\tTimer pools done." << std::endl;
+    }
+
+    {
+        std::cout << "Testing tick budgets.\n";
+        asio::io_context io;
+        TickBudget budget(std::chrono::milliseconds(2));
+
+        // 20 timers due at the same moment, each tick takes 1ms
+        int ticks = 0;
+        int ticks_before_io = -1;
+        std::vector<std::shared_ptr<RepeatingTimer<void>>> timers;
+        for (int i = 0; i < 20; i++) {
+            timers.push_back(RepeatingTimer<void>::create(io,
+                [&io, &ticks, &ticks_before_io]() {
+                    // The first tick posts some other work, like a socket read completing
+                    if (ticks++ == 0)
+                        asio::post(io, [&ticks, &ticks_before_io]() { ticks_before_io = ticks; });
+                    const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(1);
+                    while (std::chrono::steady_clock::now() < until) {}
+                },
+                std::chrono::milliseconds(100)));
+            timers.back()->set_budget(&budget);
+            timers.back()->align();
+        }
+
+        // Run the io_context in its own thread
+        std::thread io_thread([&io]{ io.run(); });
+
+        // Let them all tick once.
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        timers.clear();  // stop the timers
+
+        io_thread.join();
+        std::cout << "\tOther work ran before all ticks " << (ticks_before_io >= 0 && ticks_before_io < 20)
+                  << ", ticks deferred " << (budget.deferred() > 0) << '\n';
+
+        // Two budgets used in turn on one thread each keep their own spend
+        TickBudget first(std::chrono::milliseconds(1));
+        TickBudget second(std::chrono::milliseconds(1));
+        first.charge(std::chrono::milliseconds(2));
+        second.charge(std::chrono::nanoseconds(0));
+        std::cout << "\tBudgets kept apart " << (!first.admit() && second.admit()) << '\n';
+        std::cout << "\tTick budgets done." << std::endl;
+    }
+
+    {
+        std::cout << "Testing warm up.\n";
+        asio::io_context io;
+
+        // The call first callback still runs first, the dry run is skipped
+        auto timer = RepeatingTimer<int>::create(
+            io,
+            [](int& counter) { ++counter; },
+            std::chrono::milliseconds(10),
+            std::make_shared<int>(0),
+            [](int& counter) {
+                std::cout << "\tCalls before the first tick " << counter << '\n';
+            },
+            nullptr,
+            WarmUp::dry_run
+        );
+
+        // Without one the dry run calls the callback long before the first tick is due
+        auto dry_runs = std::make_shared<int>(0);
+        auto slow = RepeatingTimer<int>::create(
+            io,
+            [](int& counter) { ++counter; },
+            std::chrono::seconds(1),
+            dry_runs,
+            nullptr,
+            nullptr,
+            WarmUp::dry_run
+        );
+
+        // Run the io_context in its own thread
+        std::thread io_thread([&io]{ io.run(); });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(25));
+        timer.reset();  // stop the timers
+        slow.reset();
+
+        io_thread.join();
+        std::cout << "\tDry runs without a call first callback " << *dry_runs << '\n';
+        std::cout << "\tWarm up done." << std::endl;
+    }
+
+    {
+        std::cout << "Testing lateness SLOs.\n";
+        asio::io_context io;
+
+        // Every tick takes 8ms of a 5ms period until the SLO breaches, then sheds the work
+        auto shed = std::make_shared<std::atomic<bool>>(false);
+        auto timer = RepeatingTimer<std::atomic<bool>>::create(
+            io,
+            [](std::atomic<bool>& shedding) {
+                if (!shedding)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(8));
+            },
+            std::chrono::milliseconds(5),
+            shed
+        );
+
+        int violations = 0;
+        int breached = 0;
+        int recovered = 0;
+        // p50 within 1ms over the last 4 ticks
+        timer->set_slo(LatencySlo{std::chrono::milliseconds(1), 0.5, 4},
+            [&, shed](const SloReport& report) {
+                if (report.event == SloEvent::violation)
+                    violations++;
+                else if (report.event == SloEvent::breached) {
+                    breached++;
+                    *shed = true;
+                }
+                else
+                    recovered++;
+            });
+
+        // Run the io_context in its own thread
+        std::thread io_thread([&io]{ io.run(); });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        const bool breached_at_end = timer->slo_breached();
+        timer.reset();  // stop the timer
+
+        io_thread.join();
+        std::cout << "\tViolations reported " << (violations >= 3)
+                  << ", breached " << breached << ", recovered " << recovered
+                  << ", breached at end " << breached_at_end << '\n';
+
+        // p90 over 10 ticks allows exactly one late tick
+        SloWindow window;
+        window.reset(LatencySlo{std::chrono::milliseconds(1), 0.9, 10});
+        const bool first_late = window.record(true);
+        const bool second_late = window.record(true);
+        std::cout << "\tp90 of 10 breached by the first late tick " << first_late
+                  << ", by the second " << second_late << '\n';
+        // p95 over 10 and p99 over 50 allow half a late tick, which is none
+        window.reset(LatencySlo{std::chrono::milliseconds(1), 0.95, 10});
+        const bool p95_late = window.record(true);
+        window.reset(LatencySlo{std::chrono::milliseconds(1), 0.99, 50});
+        const bool p99_late = window.record(true);
+        std::cout << "\tp95 of 10 breached by the first late tick " << p95_late
+                  << ", p99 of 50 " << p99_late << '\n';
+        std::cout << "\tLateness SLOs done." << std::endl;
+    }
+
     std::cout << "Testing finished.\n";
 }
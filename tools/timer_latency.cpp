@@ -0,0 +1,243 @@
+/*
+* Copyright (c) 2025 Dean Sellers (dean@sellers.id.au)
+* SPDX-License-Identifier: MIT
+*/
+
+#include "repeatable_timer.hpp"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <stdexcept>
+
+/* cyclictest style lateness measurement through the same code path as production timers.
+
+  Runs N RepeatingTimers on M io threads and records how late every tick ran after its
+  deadline, taken from the TickInfo so the measurement adds no clock reads of its own.
+  Optional load threads keep CPUs busy or stream through memory while it runs.
+*/
+
+namespace {
+
+struct Options
+{
+    int timers = 1;
+    int threads = 1;
+    std::chrono::microseconds period{1000};
+    std::chrono::microseconds interval{0};     // between the starts of consecutive timers
+    std::chrono::seconds duration{10};
+    int cpu_load = 0;                          // spinning threads
+    int mem_load = 0;                          // memory streaming threads
+    std::size_t mem_mb = 64;                   // buffer per memory thread
+    bool per_timer = false;
+};
+
+void usage(const char* name)
+{
+    std::cout << "Usage: " << name << " [options]\n"
+              << "  -n, --timers N        timers to run (1)\n"
+              << "  -t, --threads N       io threads (1)\n"
+              << "  -p, --period US       timer period in microseconds (1000)\n"
+              << "  -i, --interval US     period added per timer, timer k runs at period + k * interval (0)\n"
+              << "  -d, --duration S      seconds to run (10)\n"
+              << "      --cpu-load N      threads spinning on a CPU each (0)\n"
+              << "      --mem-load N      threads streaming through memory (0)\n"
+              << "      --mem-mb MB       buffer per memory load thread (64)\n"
+              << "  -v, --per-timer       report every timer, not just the total\n"
+              << "  -h, --help            this text\n";
+}
+
+bool parse(int argc, char** argv, Options& o)
+{
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> long {
+            if (i + 1 >= argc)
+                throw std::invalid_argument(arg + " needs a value");
+            return std::stol(argv[++i]);
+        };
+        if (arg == "-n" || arg == "--timers")
+            o.timers = static_cast<int>(value());
+        else if (arg == "-t" || arg == "--threads")
+            o.threads = static_cast<int>(value());
+        else if (arg == "-p" || arg == "--period")
+            o.period = std::chrono::microseconds(value());
+        else if (arg == "-i" || arg == "--interval")
+            o.interval = std::chrono::microseconds(value());
+        else if (arg == "-d" || arg == "--duration")
+            o.duration = std::chrono::seconds(value());
+        else if (arg == "--cpu-load")
+            o.cpu_load = static_cast<int>(value());
+        else if (arg == "--mem-load")
+            o.mem_load = static_cast<int>(value());
+        else if (arg == "--mem-mb")
+            o.mem_mb = static_cast<std::size_t>(value());
+        else if (arg == "-v" || arg == "--per-timer")
+            o.per_timer = true;
+        else if (arg == "-h" || arg == "--help")
+            return false;
+        else
+            throw std::invalid_argument("unknown option " + arg);
+    }
+    if (o.timers < 1 || o.threads < 1 || o.period.count() < 1 || o.duration.count() < 1)
+        throw std::invalid_argument("timers, threads, period and duration must be positive");
+    return true;
+}
+
+/* Lateness histogram of one timer, 1us buckets up to 10ms and one overflow bucket.
+  Only ever touched by the tick of its own timer. */
+struct Histogram
+{
+    static constexpr std::size_t buckets = 10000;
+
+    std::vector<std::uint64_t> counts = std::vector<std::uint64_t>(buckets + 1);
+    std::uint64_t samples = 0;
+    std::chrono::nanoseconds min = std::chrono::nanoseconds::max();
+    std::chrono::nanoseconds max{0};
+    std::chrono::nanoseconds sum{0};
+
+    void add(std::chrono::nanoseconds late)
+    {
+        if (late.count() < 0)
+            late = std::chrono::nanoseconds(0);
+        const auto us = static_cast<std::size_t>(late.count() / 1000);
+        counts[us < buckets ? us : buckets]++;
+        samples++;
+        sum += late;
+        if (late < min)
+            min = late;
+        if (late > max)
+            max = late;
+    }
+
+    void merge(const Histogram& other)
+    {
+        for (std::size_t i = 0; i <= buckets; i++)
+            counts[i] += other.counts[i];
+        samples += other.samples;
+        sum += other.sum;
+        if (other.min < min)
+            min = other.min;
+        if (other.max > max)
+            max = other.max;
+    }
+
+    // Upper edge of the bucket holding quantile q, in microseconds
+    double quantile_us(double q) const
+    {
+        if (!samples)
+            return 0.0;
+        const auto target = static_cast<std::uint64_t>(q * static_cast<double>(samples - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < buckets; i++) {
+            seen += counts[i];
+            if (seen >= target)
+                return static_cast<double>(i + 1);
+        }
+        return std::chrono::duration<double, std::micro>(max).count();
+    }
+};
+
+void report(const std::string& label, const Histogram& h)
+{
+    auto us = [](std::chrono::nanoseconds d) { return std::chrono::duration<double, std::micro>(d).count(); };
+    std::cout << std::left << std::setw(8) << label << std::right << std::fixed << std::setprecision(1)
+              << " ticks " << std::setw(9) << h.samples
+              << "  min " << std::setw(8) << (h.samples ? us(h.min) : 0.0)
+              << "  avg " << std::setw(8) << (h.samples ? us(h.sum) / static_cast<double>(h.samples) : 0.0)
+              << "  max " << std::setw(8) << us(h.max)
+              << "  p99 " << std::setw(8) << h.quantile_us(0.99)
+              << "  p99.9 " << std::setw(8) << h.quantile_us(0.999)
+              << "  (us)\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+
+    Options options;
+    try {
+        if (!parse(argc, argv, options)) {
+            usage(argv[0]);
+            return 0;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::atomic<bool> loaded{true};
+    std::vector<std::thread> load;
+    for (int i = 0; i < options.cpu_load; i++) {
+        load.emplace_back([&loaded] {
+            volatile std::uint64_t spin = 0;
+            while (loaded.load(std::memory_order_relaxed))
+                spin = spin + 1;
+        });
+    }
+    for (int i = 0; i < options.mem_load; i++) {
+        load.emplace_back([&loaded, bytes = options.mem_mb << 20] {
+            std::vector<unsigned char> buffer(bytes);
+            unsigned char value = 0;
+            // A new value every pass so the writes can't be elided, one write per cache line
+            while (loaded.load(std::memory_order_relaxed)) {
+                for (std::size_t i = 0; i < buffer.size(); i += 64)
+                    buffer[i] = value;
+                value++;
+            }
+        });
+    }
+
+    asio::io_context io(options.threads);
+    auto work = asio::make_work_guard(io);
+    std::vector<std::shared_ptr<RepeatingTimer<Histogram>>> timers;
+    std::vector<std::shared_ptr<Histogram>> histograms;
+    for (int i = 0; i < options.timers; i++) {
+        histograms.push_back(std::make_shared<Histogram>());
+        timers.push_back(RepeatingTimer<Histogram>::create(
+            io,
+            [](Histogram& h, const RepeatingTimer<Histogram>::TickInfo& info) {
+                h.add(info.actual - info.scheduled);
+            },
+            options.period + options.interval * i,
+            histograms.back(),
+            nullptr,
+            nullptr,
+            WarmUp::prefault
+        ));
+    }
+
+    std::cout << "Timers " << options.timers << ", io threads " << options.threads
+              << ", period " << options.period.count() << "us";
+    if (options.interval.count())
+        std::cout << " + " << options.interval.count() << "us per timer";
+    std::cout << ", load " << options.cpu_load << " cpu / " << options.mem_load << " memory threads"
+              << ", " << options.duration.count() << "s\n";
+
+    std::vector<std::thread> io_threads;
+    for (int i = 0; i < options.threads; i++)
+        io_threads.emplace_back([&io] { io.run(); });
+
+    std::this_thread::sleep_for(options.duration);
+    timers.clear();  // stop the timers
+    work.reset();
+    for (auto& t : io_threads)
+        t.join();
+
+    loaded = false;
+    for (auto& t : load)
+        t.join();
+
+    Histogram total;
+    for (std::size_t i = 0; i < histograms.size(); i++) {
+        if (options.per_timer)
+            report("T:" + std::to_string(i), *histograms[i]);
+        total.merge(*histograms[i]);
+    }
+    report("All", total);
+}